@@ -7,14 +7,51 @@
 
 #include "main.h"
 #include "led_tile.h"
+#include "led_tile_comp.h"
+#include "led_tile_map.h"
+#include "led_tile_twinkle.h"
 #include "PCA9745/pca9745.h"
 #include "math.h"
 
-uint8_t instr_buffer[NUM_TILES];
-uint8_t rx_buffer[NUM_TILES];
-uint8_t data_buffer[NUM_TILES];
+//Static RAM of the chain drivers and of every buffer sized by TILE_MAX_TILES or PCA9745_MAX_DEV:
+//framebuffers and layers, pixel map, twinkle pool, PWMALL commit list and frame pump list
+#if TILE_PUMP
+#define TILE_PUMP_RAM	(sizeof(PCA9745_Pump) + TILE_PUMP_FRAMES * PCA9745_PUMP_STRIDE(PCA9745_MAX_DEV))
+#else
+#define TILE_PUMP_RAM	0
+#endif
+#define TILE_RAM_USED	(TILE_NUM_CHAINS * (sizeof(PCA9745_Arena) + sizeof(PCA9745_Diag) + sizeof(PCA9745_Grad)) + \
+		(2 + TILE_NUM_LAYERS) * TILE_MAX_TILES * sizeof(LED_Tile_Pixels) + \
+		sizeof(LED_Tile_Map) + TILE_MAX_TILES * sizeof(LED_Tile_Placement) + sizeof(LED_Tile_Twinkle) + \
+		PCA9745_MAX_DEV * (sizeof(uint16_t) + sizeof(uint8_t)) + TILE_PUMP_RAM)
 
-PCA9745 p;
+_Static_assert(TILE_MAX_TILES <= TILE_NUM_CHAINS * PCA9745_MAX_DEV, "TILE_MAX_TILES is more than the chains can drive");
+_Static_assert(!TILE_PUMP || TILE_NUM_CHAINS == 1, "TILE_PUMP drives a single chain, set TILE_NUM_CHAINS to 1");
+_Static_assert(TILE_RAM_USED <= TILE_RAM_BUDGET, "LED tile buffers exceed TILE_RAM_BUDGET, lower PCA9745_MAX_DEV or TILE_MAX_TILES");
+
+PCA9745_Arena arena[TILE_NUM_CHAINS];
+
+PCA9745 p[TILE_NUM_CHAINS];
+
+PCA9745_Diag diag[TILE_NUM_CHAINS];
+
+PCA9745_Grad grad[TILE_NUM_CHAINS];
+
+#if TILE_OE_TIM
+PCA9745_OE_Timer oe;
+#endif
+
+#if TILE_PUMP
+PCA9745_Pump pump;
+uint8_t pump_list[TILE_PUMP_FRAMES * PCA9745_PUMP_STRIDE(PCA9745_MAX_DEV)];
+#endif
+
+LED_Tile_Pixels fb[TILE_MAX_TILES];
+LED_Tile_Pixels fb_sent[TILE_MAX_TILES];
+
+//PWMALL list built by LED_Tile_Commit, one chain at a time
+static uint16_t commit_dev[PCA9745_MAX_DEV];
+static uint8_t commit_data[PCA9745_MAX_DEV];
 
 /**
   * @brief  Initialize LED Tile
@@ -22,273 +59,748 @@ PCA9745 p;
   *
   * @note	NOTE: See "led_tile.h" for configuration
   *
-  * @param  void
-  * @retval None
+  * @note	The number of tiles is a runtime value, up to TILE_MAX_TILES. Tiles are
+  * 		split evenly across the TILE_NUM_CHAINS chains and addressed by a global index.
+  *
+  * @param  uint16_t num_tiles
+  * @retval LED_Tile
   */
-LED_Tile Init_LED_Tile(){
+LED_Tile Init_LED_Tile(uint16_t num_tiles){
 	LED_Tile tile;
 
-	//Configure PCA9745 driver
-	p = Init_PCA9745(&TILE_SPI, TILE_CS_PORT, TILE_CS_PIN, TILE_OE_PORT, TILE_OE_PIN);
-	_PCA9745_Configure(&p, R_EXT, NUM_TILES, instr_buffer, data_buffer, rx_buffer);
-	tile.p = &p;
+	//Configure PCA9745 drivers, one per chain
+	p[0] = Init_PCA9745(&TILE_SPI, TILE_CS_PORT, TILE_CS_PIN, TILE_OE_PORT, TILE_OE_PIN);
+#if TILE_NUM_CHAINS > 1
+	p[1] = Init_PCA9745(&TILE_SPI_1, TILE_CS_PORT_1, TILE_CS_PIN_1, TILE_OE_PORT_1, TILE_OE_PIN_1);
+#endif
+#if TILE_NUM_CHAINS > 2
+	p[2] = Init_PCA9745(&TILE_SPI_2, TILE_CS_PORT_2, TILE_CS_PIN_2, TILE_OE_PORT_2, TILE_OE_PIN_2);
+#endif
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		_PCA9745_Configure(&p[c], R_EXT, 0, &arena[c]);
+		_PCA9745_Set_DMA(&p[c], TILE_SPI_DMA);
+		tile.chain[c] = &p[c];
+		PCA9745_Diag_Init(&diag[c], &p[c], TILE_DIAG_BUDGET);
+		tile.diag[c] = &diag[c];
+		PCA9745_Grad_Init(&grad[c], &p[c]);
+		tile.grad[c] = &grad[c];
+	}
+	tile.p = &p[0];
+#if TILE_OE_TIM
+	PCA9745_OE_Init(&oe, &p[0], &TILE_OE_HTIM, TILE_OE_CHANNEL, TILE_OE_AF, TILE_OE_TIM_MHZ, TILE_OE_PERIOD_US);
+	tile.oe = &oe;
+#else
+	tile.oe = NULL;
+#endif
+#if TILE_PUMP
+	//A slot is one byte at the SPI clock plus the nCS lead and the DMA latency allowed
+	uint32_t spi_div = 2UL << ((TILE_SPI.Init.BaudRatePrescaler >> 3) & 0x07);
+	PCA9745_Pump_Init(&pump, &p[0], pump_list, sizeof(pump_list),
+			&TILE_PUMP_SLOT_HTIM, 8 * spi_div * TILE_PUMP_TIM_X + TILE_PUMP_LEAD + TILE_PUMP_GUARD, TILE_PUMP_LEAD,
+			&TILE_PUMP_CS_HTIM, TILE_PUMP_CS_TRIGGER, TILE_PUMP_CS_CHANNEL, TILE_PUMP_CS_AF,
+			TILE_PUMP_DMA, TILE_PUMP_DMA_CHANNEL);
+	HAL_NVIC_SetPriority(TILE_PUMP_DMA_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(TILE_PUMP_DMA_IRQn);
+	tile.pump = &pump;
+#else
+	tile.pump = NULL;
+#endif
+	tile.fb = fb;
+	tile.sent = fb_sent;
+	tile.map = NULL;
+	tile.master = 255;
+	LED_Tile_Set_Num_Tiles(&tile, num_tiles);
+
+	//Solve the intensity curves once
+	LED_Tile_Build_IREF_LUT(&tile, TILE_RED, R_A, R_B);
+	LED_Tile_Build_IREF_LUT(&tile, TILE_GREEN, G_A, G_B);
+	LED_Tile_Build_IREF_LUT(&tile, TILE_BLUE, B_A, B_B);
+	LED_Tile_Build_IREF_LUT(&tile, TILE_IR, IR_A, IR_B);
 
 	//Configure update timer
 	tile.update_timer.htim = &TILE_TIM;
 	tile.update_timer.tim_mhz = TILE_TIM_MHZ;
 	tile.update_timer.update_freq = 100;
+	tile.update_timer.period_us = 1000000 / 100;
+
+	//No effect selected
+	tile.fx.active = NULL;
+	tile.fx.pending = NULL;
+	tile.fx.dt_us = 1000000 / 100;
+	tile.fx.en = 0;
+	tile.fx.ticks = 0;
+	tile.fx.tick_stamp = 0;
+	tile.fx.frames = 0;
+	tile.fx.isr_cycles = 0;
+	tile.fx.render_cycles = 0;
+	tile.fx.frame_start = tile.fx.frame_end = 0;
+	tile.fx.load_cycles = 0;
+	tile.fx.missed = 0;
+	tile.fx.dropped = 0;
+	tile.fx.target_us = tile.fx.dt_us;
+	tile.fx.policy = 0;
+	tile.fx.adapt = 0;
+
+	//Cycle counter for the render timing
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 	return tile;
 }
 
 /**
-  * @brief  Set Relative Intensity of LED
-  * @note	Using a lookup function, that uses Newton-Raphson first order approximation
-  * 		to find the current at a specified intensity, a 8-bit value is returned and
-  * 		set using the IREFx registers.
+  * @brief  Set Number of Tiles
+  * @note	Change the number of tiles at runtime, clamped to TILE_MAX_TILES. The tiles are split
+  * 		evenly across the chains, the first chains taking the remainder.
   *
-  * @param  LED_Tile *tile, uint16_t dev, uint8_t LED, float intensity
+  * @param  LED_Tile *tile, uint16_t num_tiles
   * @retval None
   */
-void LED_Tile_Set_LED_Intensity(LED_Tile *tile, uint16_t dev, uint8_t LED, float intensity){
-	if(LED == 5){	//Set IR Intensity
-		float ir_Io = Get_Intensity(intensity, IR_A, IR_B);
-		PCA9745_Set_IREFx(tile->p, dev, 15, ir_Io);
+void LED_Tile_Set_Num_Tiles(LED_Tile *tile, uint16_t num_tiles){
+	uint16_t start = 0;
+	if(num_tiles > TILE_MAX_TILES){
+		num_tiles = TILE_MAX_TILES;
 	}
-	else{	//Set RGB Intensity
-		float r_Io = Get_Intensity(intensity, R_A, R_B);
-		float g_Io = Get_Intensity(intensity, G_A, G_B);
-		float b_Io = Get_Intensity(intensity, B_A, B_B);
-		PCA9745_Set_IREFx(tile->p, dev, LED * 3 - 0, r_Io);
-		PCA9745_Set_IREFx(tile->p, dev, LED * 3 - 1, g_Io);
-		PCA9745_Set_IREFx(tile->p, dev, LED * 3 - 2, b_Io);
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		uint16_t n = num_tiles / TILE_NUM_CHAINS + (c < num_tiles % TILE_NUM_CHAINS ? 1 : 0);
+		_PCA9745_Set_Num_Dev(tile->chain[c], n);
+		tile->chain_start[c] = start;
+		start += tile->chain[c]->num_dev;
 	}
+	tile->num_tiles = start;
+	tile->resync = 1;
 }
 
 /**
-  * @brief  Set Color of LED
-  * @note	Set the respective PWM register values of the RGB LED channels
+  * @brief  Get Chain Index of a Tile
+  * @note	Map a global tile index to the index of its chain (in chain[], diag[] and grad[])
+  * 		and the device index within that chain.
   *
-  * @param  LED_Tile *tile, uint16_t dev, uint8_t LED, uint8 red, uint8_t green, uint8_t blue
-  * @retval None
+  * @param  LED_Tile *tile, uint16_t tile_index, uint16_t *dev
+  * @retval uint8_t - chain index
   */
-void LED_Tile_Set_LED_Color(LED_Tile *tile, uint16_t dev, uint8_t LED, uint8_t red, uint8_t green, uint8_t blue){
-	PCA9745_Set_PWMx(tile->p, dev, LED * 3 + 0, red);
-	PCA9745_Set_PWMx(tile->p, dev, LED * 3 + 1, green);
-	PCA9745_Set_PWMx(tile->p, dev, LED * 3 + 2, blue);
+uint8_t LED_Tile_Get_Chain_Index(LED_Tile *tile, uint16_t tile_index, uint16_t *dev){
+	uint8_t c = TILE_NUM_CHAINS - 1;
+	while(c > 0 && tile_index < tile->chain_start[c]){
+		c--;
+	}
+	*dev = tile_index - tile->chain_start[c];
+	return c;
 }
 
 /**
-  * @brief  Set Color of LEDs on Each Tile
-  * @note	Set the respective PWM register values of the RGB LED channels
+  * @brief  Get Chain of a Tile
+  * @note	Map a global tile index to its chain and the device index within that chain.
   *
-  * @param  LED_Tile *tile, uint8 red, uint8_t green, uint8_t blue
+  * @param  LED_Tile *tile, uint16_t tile_index, uint16_t *dev
+  * @retval PCA9745 * - chain driving the tile
+  */
+PCA9745 *LED_Tile_Get_Chain(LED_Tile *tile, uint16_t tile_index, uint16_t *dev){
+	return tile->chain[LED_Tile_Get_Chain_Index(tile, tile_index, dev)];
+}
+
+/**
+  * @brief  Begin a Batch of Updates
+  * @note	Stage all following register writes on every chain until LED_Tile_Flush.
+  *
+  * @param  LED_Tile *tile
   * @retval None
   */
-void LED_Tile_Set_LED_Color_All(LED_Tile *tile, uint8_t r, uint8_t g, uint8_t b){
-	for(uint8_t led = 0; led < 5; led++){
-		for(uint16_t dev = 0; dev < NUM_TILES; dev++){
-			LED_Tile_Set_LED_Color(tile, dev, led, r, g, b);
+void LED_Tile_Begin(LED_Tile *tile){
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		tile->chain[c]->deferred = 1;
+	}
+}
+
+/**
+  * @brief  Flush a Batch of Updates
+  * @note	Send everything staged since LED_Tile_Begin. The chains are stepped one frame at a
+  * 		time in turn, so with DMA enabled every bus is shifting a frame at the same time.
+  *
+  * @param  LED_Tile *tile
+  * @retval uint16_t - frames sent on the busiest chain
+  */
+uint16_t LED_Tile_Flush(LED_Tile *tile){
+	uint16_t frames = 0;
+	uint8_t pending = 1;
+	while(pending){
+		pending = 0;
+		for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+			pending |= PCA9745_Flush_Step(tile->chain[c]);
 		}
+		frames += pending;
+	}
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		tile->chain[c]->deferred = 0;
 	}
+	return frames;
 }
 
 /**
-  * @brief  Set Color of LED
-  * @note	Set the respective IR register values of the IR LED channel
+  * @brief  SPI Transfer Complete
+  * @note	Call from HAL_SPI_TxCpltCallback and HAL_SPI_TxRxCpltCallback to release the nCS
+  * 		of the chain on that bus.
+  *
+  * @param  LED_Tile *tile, SPI_HandleTypeDef *hspi
+  * @retval None
+  */
+void LED_Tile_SPI_Complete(LED_Tile *tile, SPI_HandleTypeDef *hspi){
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		_PCA9745_TxCplt(tile->chain[c], hspi);
+	}
+}
+
+/**
+  * @brief  Draw LED Color
+  * @note	Set the RGB channels of an LED in the framebuffer. Nothing is sent until LED_Tile_Commit.
+  *
+  * @param  LED_Tile *tile, uint16_t dev, uint8_t LED, uint8 red, uint8_t green, uint8_t blue
+  * @retval None
+  */
+void LED_Tile_Draw_LED(LED_Tile *tile, uint16_t dev, uint8_t LED, uint8_t red, uint8_t green, uint8_t blue){
+	uint8_t *ch = tile->fb[dev].ch;
+	ch[TILE_LED_CH(LED, TILE_RED)] = red;
+	ch[TILE_LED_CH(LED, TILE_GREEN)] = green;
+	ch[TILE_LED_CH(LED, TILE_BLUE)] = blue;
+}
+
+/**
+  * @brief  Draw IR LED
+  * @note	Set the IR channel of a tile in the framebuffer. Nothing is sent until LED_Tile_Commit.
   *
   * @param  LED_Tile *tile, uint16_t dev, uint8_t value
   * @retval None
   */
-void LED_Tile_Set_IR_LED(LED_Tile *tile, uint16_t dev, uint8_t value){
-	PCA9745_Set_PWMx(tile->p, dev, 15, value);
+void LED_Tile_Draw_IR(LED_Tile *tile, uint16_t dev, uint8_t value){
+	tile->fb[dev].ch[TILE_IR_CH] = value;
 }
 
 /**
-  * @brief  Clear All Color in Tile
-  * @note	Set the respective PWM register to zero
+  * @brief  Fill the Framebuffer
+  * @note	Set every RGB LED of every tile in the framebuffer, leaving the IR channels unchanged.
   *
-  * @param  LED_Tile *tile, uint16_t dev
+  * @param  LED_Tile *tile, uint8 r, uint8_t g, uint8_t b
   * @retval None
   */
-void LED_Tile_Clear(LED_Tile *tile, uint16_t dev){
-	for(uint8_t i = 0; i < 16; i++){
-		PCA9745_Set_PWMx(tile->p, dev, i, 0);
+void LED_Tile_Fill(LED_Tile *tile, uint8_t r, uint8_t g, uint8_t b){
+	for(uint16_t dev = 0; dev < tile->num_tiles; dev++){
+		for(uint8_t led = 0; led < TILE_NUM_LEDS; led++){
+			LED_Tile_Draw_LED(tile, dev, led, r, g, b);
+		}
 	}
 }
 
 /**
-  * @brief  Clear All Color in All Tiles
-  * @note	Set the respective PWM register to zero
+  * @brief  Commit the Framebuffer
+  * @note	Send everything drawn since the last commit. Tiles are compared against the last sent
+  * 		values four channels at a time and unchanged tiles cost nothing. A changed tile whose 16
+  * 		channels are all equal is sent with PWMALL, every such tile of a chain sharing one frame.
+  * 		The remaining changed channels are staged and flushed, one register per tile per frame,
+  * 		on all chains at once.
+  *
+  * @note	With TILE_PUMP (single chain only) the frames are captured into the frame pump's list
+  * 		and sent by timers and DMA once the commit is built, so this returns without waiting
+  * 		for the chain.
+  *
+  * @param  LED_Tile *tile
+  * @retval uint16_t - frames sent on the busiest chain
+  */
+uint16_t LED_Tile_Commit(LED_Tile *tile){
+	uint8_t broadcast = 0;
+	uint16_t frames;
+	LED_Tile_Begin(tile);
+	if(tile->pump != NULL){
+		PCA9745_Pump_Begin(tile->pump);
+	}
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		PCA9745 *chain = tile->chain[c];
+		uint16_t n = 0;
+		for(uint16_t dev = 0; dev < chain->num_dev; dev++){
+			LED_Tile_Pixels *f = &tile->fb[tile->chain_start[c] + dev];
+			LED_Tile_Pixels *s = &tile->sent[tile->chain_start[c] + dev];
+			uint8_t changed = tile->resync;
+			for(uint8_t k = 0; k < 4; k++){
+				changed |= (f->w[k] != s->w[k]);
+			}
+			if(!changed){
+				continue;
+			}
+
+			uint32_t fill = f->ch[0] * 0x01010101UL;
+			if(f->w[0] == fill && f->w[1] == fill && f->w[2] == fill && f->w[3] == fill){
+				commit_dev[n] = dev;
+				commit_data[n] = f->ch[0];
+				n++;
+			}
+			else{
+				for(uint8_t k = 0; k < 4; k++){
+					if(f->w[k] != s->w[k] || tile->resync){
+						for(uint8_t ch = k * 4; ch < k * 4 + 4; ch++){
+							PCA9745_Set_PWMx(chain, dev, ch, f->ch[ch]);
+						}
+					}
+				}
+			}
+			*s = *f;
+		}
+		if(n > 0){
+			broadcast |= PCA9745_Set_PWMALL_Multi(chain, commit_dev, commit_data, n);
+		}
+	}
+	tile->resync = 0;
+	frames = broadcast + LED_Tile_Flush(tile);
+	if(tile->pump != NULL){
+		PCA9745_Pump_Start(tile->pump);
+	}
+	return frames;
+}
+
+/**
+  * @brief  Frame Pump DMA Interrupt
+  * @note	Call from the IRQ handler of TILE_PUMP_DMA.
   *
   * @param  LED_Tile *tile
   * @retval None
   */
-void LED_Tile_Clear_All(LED_Tile *tile){
-	for(uint8_t i = 0; i < NUM_TILES; i++){
-		LED_Tile_Clear(tile, i);
+void LED_Tile_Pump_IRQHandler(LED_Tile *tile){
+	if(tile->pump != NULL){
+		PCA9745_Pump_IRQHandler(tile->pump);
 	}
 }
 
 /**
-  * @brief  Tests All Color in All Tiles
-  * @note	Tests red, green, blue values of all LEDs in all tiles
+  * @brief  Step the Diagnostics Scanners
+  * @note	Read TILE_DIAG_BUDGET registers of the background MODE2/EFLAG scan on each chain,
+  * 		TILE_DIAG_BUDGET + 1 read frames. Call once per animation frame, after LED_Tile_Commit.
   *
   * @param  LED_Tile *tile
   * @retval None
   */
-void LED_Tile_Test_All(LED_Tile *tile){
-	for(uint8_t r = 0; r < 255; r++){
-		LED_Tile_Set_LED_Color_All(tile, r, 0, 0);
-		HAL_Delay(1);
+void LED_Tile_Diag_Step(LED_Tile *tile){
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		PCA9745_Diag_Step(tile->diag[c]);
 	}
-	for(uint8_t g = 0; g < 255; g++){
-		LED_Tile_Set_LED_Color_All(tile, 0, g, 0);
-		HAL_Delay(1);
+}
+
+/**
+  * @brief  Get Diagnostics Status of a Tile
+  * @note	Latest open/short channel masks and over temperature flag published by the
+  * 		background scanner. Channel n of LED k is bit k * 3 + n, the IR LED is bit 15.
+  *
+  * @param  LED_Tile *tile, uint16_t dev, PCA9745_Diag_Status *s
+  * @retval uint8_t - 1 if s is valid
+  */
+uint8_t LED_Tile_Get_Status(LED_Tile *tile, uint16_t dev, PCA9745_Diag_Status *s){
+	uint16_t d;
+	uint8_t c = LED_Tile_Get_Chain_Index(tile, dev, &d);
+	return PCA9745_Diag_Get(tile->diag[c], d, s);
+}
+
+/**
+  * @brief  Fade an LED in Hardware
+  * @note	Draw the colour into the framebuffer and let the tile's gradation engine ramp the LED
+  * 		up over ramp_ms, hold it for hold_ms and ramp it back down to off. After this call the
+  * 		fade costs no SPI traffic. The peak current is the green channel's IREF (see
+  * 		LED_Tile_Set_Intensity_All), the colour is set by the PWM values on LED_Tile_Commit.
+  *
+  * @note	Each tile has four gradation groups. Fades with the same (quantized) profile share a
+  * 		group's registers, see PCA9745_Grad_Fade. When the fade is over the LED stays dark in
+  * 		gradation mode until LED_Tile_Fade_Release.
+  *
+  * @param  LED_Tile *tile, uint16_t dev, uint8_t LED, uint8_t red, uint8_t green, uint8_t blue, uint32_t ramp_ms, uint32_t hold_ms
+  * @retval uint8_t - 1 if the fade started, 0 if all four groups of the tile are busy
+  */
+uint8_t LED_Tile_Fade_LED(LED_Tile *tile, uint16_t dev, uint8_t LED, uint8_t red, uint8_t green, uint8_t blue, uint32_t ramp_ms, uint32_t hold_ms){
+	uint16_t d;
+	uint8_t c = LED_Tile_Get_Chain_Index(tile, dev, &d);
+	uint8_t iref;
+	if(!PCA9745_Get_Shadow(tile->chain[c], d, IREF15 - TILE_LED_CH(LED, TILE_GREEN), &iref)){
+		iref = LED_Tile_IREF_Code(tile, TILE_GREEN, LED_Tile_Intensity_Level(1.0f));
 	}
-	for(uint8_t b = 0; b < 255; b++){
-		LED_Tile_Set_LED_Color_All(tile, 0, 0, b);
-		HAL_Delay(1);
+
+	PCA9745_Grad_Profile prof = PCA9745_Grad_Make_Profile(iref, ramp_ms, hold_ms);
+	uint16_t channels = 0x07 << TILE_LED_CH(LED, TILE_RED);
+	if(PCA9745_Grad_Fade(tile->grad[c], d, channels, &prof) == PCA9745_GRAD_NONE){
+		return 0;
 	}
+	LED_Tile_Draw_LED(tile, dev, LED, red, green, blue);
+	return 1;
 }
 
 /**
-  * @brief  Initialize twinkle mode
-  * @note	Set the twinkle chance frequency based on psuedo-random values
-  * 		and set the maximum number of twinkles allowed at once.
+  * @brief  Release an LED from Hardware Fading
+  * @note	Clear the LED in the framebuffer and return its channels to normal mode. Both go out
+  * 		with the next LED_Tile_Commit, the PWM registers before GRAD_MODE_SEL.
   *
-  * @note	WARNING: Increasing the twinkle number will greatly reduce maximum
-  * 		update speed. Keep this number relatively low and keep it below the following limit:
-  * 			0 < num <= NUM_TILES * 5
+  * @param  LED_Tile *tile, uint16_t dev, uint8_t LED
+  * @retval None
+  */
+void LED_Tile_Fade_Release(LED_Tile *tile, uint16_t dev, uint8_t LED){
+	uint16_t d;
+	uint8_t c = LED_Tile_Get_Chain_Index(tile, dev, &d);
+	LED_Tile_Draw_LED(tile, dev, LED, 0, 0, 0);
+	PCA9745_Grad_Release(tile->grad[c], d, 0x07 << TILE_LED_CH(LED, TILE_RED));
+}
+
+/**
+  * @brief  Build IREF Lookup Table
+  * @note	Solve the intensity curve a*x^2 + b*x of one colour with Get_Intensity at
+  * 		TILE_IREF_LUT_SIZE + 1 evenly spaced intensities from 0 to MAX_INTESITY, and store the
+  * 		matching IREF codes in Q8. Currents above the IREF range saturate at 0xFF.
   *
-  * @param  LED_Tile *tile, uint16_t chance, uint8_t num
+  * @note	Called for every colour by Init_LED_Tile. Call again with new coefficients to recalibrate.
+  *
+  * @param  LED_Tile *tile, LED_Tile_Color color, float a, float b
   * @retval None
   */
-void LED_Tile_Twinkle_Init(LED_Tile *tile, uint16_t chance, uint8_t num){
-	tile->twinkle.chance = chance;
-	tile->twinkle.num = num;
+void LED_Tile_Build_IREF_LUT(LED_Tile *tile, LED_Tile_Color color, float a, float b){
+	for(uint16_t i = 0; i <= TILE_IREF_LUT_SIZE; i++){
+		float x = Get_Intensity(MAX_INTESITY * i / TILE_IREF_LUT_SIZE, a, b);
+		float code = 4 * tile->p->r_ext * x / 900 * 256.0f;		//See PCA9745_Set_IREFx
+		if(code < 0.0f){
+			code = 0.0f;
+		}
+		if(code > 255.0f * 256.0f){
+			code = 255.0f * 256.0f;
+		}
+		tile->iref_lut[color][i] = (uint16_t)code;
+	}
+}
+
+/**
+  * @brief  Convert Relative Intensity to Level
+  * @note	Map an intensity from 0 to MAX_INTESITY onto the 16-bit level used by LED_Tile_IREF_Code.
+  * 		Out of range values are clamped.
+  *
+  * @param  float intensity
+  * @retval uint16_t
+  */
+uint16_t LED_Tile_Intensity_Level(float intensity){
+	if(intensity > MAX_INTESITY){
+		intensity = MAX_INTESITY;
+	}
+	if(intensity < 0){
+		intensity = 0.0f;
+	}
+	return (uint16_t)(intensity * (65535.0f / MAX_INTESITY));
 }
 
 /**
-  * @brief  Start twinkle mode
-  * @note	Start the twinkle mode with a fixed time step.
+  * @brief  Look up IREF Code
+  * @note	IREF code of a colour at a 16-bit intensity level (0 - MAX_INTESITY), linearly
+  * 		interpolated between the two nearest table points in integer arithmetic.
   *
-  * @note	This also sets all twinkles to inactive
+  * @param  LED_Tile *tile, LED_Tile_Color color, uint16_t level
+  * @retval uint8_t
+  */
+uint8_t LED_Tile_IREF_Code(LED_Tile *tile, LED_Tile_Color color, uint16_t level){
+	const uint16_t *lut = tile->iref_lut[color];
+	uint16_t i = level >> (16 - TILE_IREF_LUT_BITS);
+	int32_t frac = level & ((1 << (16 - TILE_IREF_LUT_BITS)) - 1);
+	int32_t code = lut[i] + (((lut[i + 1] - lut[i]) * frac) >> (16 - TILE_IREF_LUT_BITS));
+	return code >> 8;
+}
+
+/**
+  * @brief  Benchmark the IREF Lookup
+  * @note	Sweep the red curve over 256 intensities and measure the average cycles per call of the
+  * 		Newton-Raphson solver and of the lookup table using the DWT cycle counter. max_error is
+  * 		the largest difference between the two IREF codes.
   *
-  * @param  LED_Tile *tile, uint16_t chance, float freq
+  * @param  LED_Tile *tile, uint32_t *solver_cycles, uint32_t *lut_cycles, uint8_t *max_error
   * @retval None
   */
-void LED_Tile_Twinkle_Start(LED_Tile *tile, float freq){
-	tile->twinkle.en = 1;
-	tile->twinkle.time_step = 1.0f / freq;
-	for(uint8_t i = 0; i < TWINKLE_NUM_MAX; i++){
-		tile->twinkle.twinkles[i].active = 0;
+void LED_Tile_Benchmark_IREF(LED_Tile *tile, uint32_t *solver_cycles, uint32_t *lut_cycles, uint8_t *max_error){
+	uint32_t solver = 0, lut = 0, start;
+	*max_error = 0;
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	for(uint16_t i = 0; i < 256; i++){
+		float intensity = MAX_INTESITY * i / 256;
+
+		start = DWT->CYCCNT;
+		float x = Get_Intensity(intensity, R_A, R_B);
+		solver += DWT->CYCCNT - start;
+
+		start = DWT->CYCCNT;
+		uint8_t code = LED_Tile_IREF_Code(tile, TILE_RED, LED_Tile_Intensity_Level(intensity));
+		lut += DWT->CYCCNT - start;
+
+		float exact = 4 * tile->p->r_ext * x / 900;
+		uint8_t expected = (exact > 255.0f) ? 255 : (uint8_t)exact;
+		uint8_t error = (code > expected) ? code - expected : expected - code;
+		if(error > *max_error){
+			*max_error = error;
+		}
 	}
-	Start_Update_Timer(tile, freq);
+	*solver_cycles = solver / 256;
+	*lut_cycles = lut / 256;
 }
 
 /**
-  * @brief  Stop twinkle mode
-  * @note	Stop the twinkle mode.
+  * @brief  Set Relative Intensity of LED
+  * @note	The IREF code of each channel is looked up in the tables built by
+  * 		LED_Tile_Build_IREF_LUT and set using the IREFx registers.
   *
-  * @note	This also sets all of the currently active twinkle LED's to zero.
+  * @param  LED_Tile *tile, uint16_t dev, uint8_t LED, float intensity
+  * @retval None
+  */
+void LED_Tile_Set_LED_Intensity(LED_Tile *tile, uint16_t dev, uint8_t LED, float intensity){
+	PCA9745 *chain = LED_Tile_Get_Chain(tile, dev, &dev);
+	uint16_t level = LED_Tile_Intensity_Level(intensity);
+	if(LED == TILE_NUM_LEDS){	//Set IR Intensity
+		PCA9745_Set_IREFx_Code(chain, dev, TILE_IR_CH, LED_Tile_IREF_Code(tile, TILE_IR, level));
+	}
+	else{	//Set RGB Intensity
+		PCA9745_Set_IREFx_Code(chain, dev, TILE_LED_CH(LED, TILE_RED), LED_Tile_IREF_Code(tile, TILE_RED, level));
+		PCA9745_Set_IREFx_Code(chain, dev, TILE_LED_CH(LED, TILE_GREEN), LED_Tile_IREF_Code(tile, TILE_GREEN, level));
+		PCA9745_Set_IREFx_Code(chain, dev, TILE_LED_CH(LED, TILE_BLUE), LED_Tile_IREF_Code(tile, TILE_BLUE, level));
+	}
+}
+
+/**
+  * @brief  Set Relative Intensity of All LEDs
+  * @note	Program the IREFx registers of every RGB and IR channel on every tile. The red current is
+  * 		broadcast to all channels of all tiles with IREFALL in one frame per chain, then only the
+  * 		green, blue and IR channels whose value differs are rewritten, packed one register per
+  * 		tile per frame.
   *
-  * @param  LED_Tile *tile
+  * @param  LED_Tile *tile, float intensity
   * @retval None
   */
-void LED_Tile_Twinkle_Stop(LED_Tile *tile){
-	Stop_Update_Timer(tile);
-	tile->twinkle.en = 0;
-	for(uint8_t i = 0; i < tile->twinkle.num; i++){
-		if(tile->twinkle.twinkles[i].active == 1){
-			LED_Tile_Set_LED_Color(tile, tile->twinkle.twinkles[i].dev, tile->twinkle.twinkles[i].led, 0, 0, 0);
+void LED_Tile_Set_Intensity_All(LED_Tile *tile, float intensity){
+	uint16_t level = LED_Tile_Intensity_Level(intensity);
+	uint8_t r_code = LED_Tile_IREF_Code(tile, TILE_RED, level);
+	uint8_t g_code = LED_Tile_IREF_Code(tile, TILE_GREEN, level);
+	uint8_t b_code = LED_Tile_IREF_Code(tile, TILE_BLUE, level);
+	uint8_t ir_code = LED_Tile_IREF_Code(tile, TILE_IR, level);
+
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		PCA9745_Set_IREFALL_Code(tile->chain[c], PCA9745_ALL_DEVICES, r_code);
+	}
+	LED_Tile_Begin(tile);
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		PCA9745 *chain = tile->chain[c];
+		for(uint16_t dev = 0; dev < chain->num_dev; dev++){
+			for(uint8_t led = 0; led < TILE_NUM_LEDS; led++){
+				PCA9745_Set_IREFx_Code(chain, dev, TILE_LED_CH(led, TILE_GREEN), g_code);
+				PCA9745_Set_IREFx_Code(chain, dev, TILE_LED_CH(led, TILE_BLUE), b_code);
+			}
+			PCA9745_Set_IREFx_Code(chain, dev, TILE_IR_CH, ir_code);
 		}
 	}
+	LED_Tile_Flush(tile);
 }
 
 /**
-  * @brief  Update twinkle mode
-  * @note	Updates the twinkle mode. Iterate through the active twinkles and increment the time in the
-  * 		exponential decay function. Each RGB value is determined using the following function:
-  * 			scale = scale_init * exp(-a_0 * t) - exp(-a_1 * t);
-  * 		Where scale_init is the unity gain factor for the decay function.
+  * @brief  Set Master Brightness
+  * @note	Dim every channel of every tile with the group PWM of the drivers (0 - off, 255 - full),
+  * 		without touching the PWMx or IREFx registers, so effects keep rendering full scale
+  * 		colours. All channels are put in LEDOUT state 11 the first time (4 frames per chain),
+  * 		after that a change of level is a single GRPPWM frame per chain. Stops blinking.
   *
-  * @note	Create a random twinkle chance and if it is lower than the programmable twinkle chance, then
-  * 		spawn a new twinkle.
+  * @param  LED_Tile *tile, uint8_t level
+  * @retval None
+  */
+void LED_Tile_Set_Master(LED_Tile *tile, uint8_t level){
+	tile->master = level;
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		PCA9745_Set_LEDOUT_All(tile->chain[c], PCA9745_ALL_DEVICES, 0x03);
+		PCA9745_Set_Group_Dim(tile->chain[c], PCA9745_ALL_DEVICES, level);
+	}
+}
+
+/**
+  * @brief  Blink All LEDs
+  * @note	Blink every channel of every tile with the group blink of the drivers. The period is
+  * 		rounded to a multiple of 1 / 15.26 s and limited to 66 ms - 16.8 s, the LEDs are on for
+  * 		duty / 256 of it. A period of 0 stops blinking and restores the master brightness.
   *
-  * @param  LED_Tile *tile
+  * @param  LED_Tile *tile, uint32_t period_ms, uint8_t duty
   * @retval None
   */
-void LED_Tile_Twinkle_Update(LED_Tile *tile){
-	if(tile->twinkle.en == 1){
-		for(uint8_t i = 0; i < tile->twinkle.num; i++){
-			if(tile->twinkle.twinkles[i].active == 1){
-				tile->twinkle.twinkles[i].t += tile->twinkle.time_step;
-				float scale = f_brightness(tile->twinkle.twinkles[i].a_0, tile->twinkle.twinkles[i].a_1, tile->twinkle.twinkles[i].t) * tile->twinkle.twinkles[i].scale;
-				uint8_t r = tile->twinkle.twinkles[i].r * scale;
-				uint8_t g = tile->twinkle.twinkles[i].g * scale;
-				uint8_t b = tile->twinkle.twinkles[i].b * scale;
-
-				//If twinkle has reached a minimum value, set twinkle to inactive
-				if(r <= 1 && g <= 1 && b <= 1 && tile->twinkle.twinkles[i].t > tile->twinkle.twinkles[i].t_max){
-					LED_Tile_Set_LED_Color(tile, tile->twinkle.twinkles[i].dev, tile->twinkle.twinkles[i].led, 0, 0, 0);
-					tile->twinkle.twinkles[i].active = 0;
-				}
-				else{
-					LED_Tile_Set_LED_Color(tile, tile->twinkle.twinkles[i].dev, tile->twinkle.twinkles[i].led, r, g, b);
+void LED_Tile_Set_Blink(LED_Tile *tile, uint32_t period_ms, uint8_t duty){
+	if(period_ms == 0){
+		LED_Tile_Set_Master(tile, tile->master);
+		return;
+	}
+	uint32_t freq = (period_ms * 1526 + 50000) / 100000;
+	freq = (freq > 256) ? 255 : ((freq == 0) ? 0 : freq - 1);
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		PCA9745_Set_LEDOUT_All(tile->chain[c], PCA9745_ALL_DEVICES, 0x03);
+		PCA9745_Set_Group_Blink(tile->chain[c], PCA9745_ALL_DEVICES, freq, duty);
+	}
+}
+
+/**
+  * @brief  Set Output Dimmer
+  * @note	Enable the outputs of every tile for duty / 65536 of the time by PWMing nOE from a
+  * 		timer (0 - off, 0xFFFF - fully on). No SPI traffic and no CPU time per frame, so it can
+  * 		be used for fades to black on top of the master brightness. Without TILE_OE_TIM the
+  * 		outputs are only switched, off for a duty of 0 and on otherwise.
+  * 		The outputs are off from Init_LED_Tile until the first call.
+  *
+  * @param  LED_Tile *tile, uint16_t duty
+  * @retval None
+  */
+void LED_Tile_Set_Dimmer(LED_Tile *tile, uint16_t duty){
+	if(tile->oe != NULL){
+		PCA9745_OE_Set_Duty(tile->oe, duty);
+		return;
+	}
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		_PCA9745_OE(tile->chain[c], duty == 0);
+	}
+}
+
+/**
+  * @brief  Strobe All LEDs
+  * @note	Turn the outputs of every tile on for a single pulse of width_us timed in hardware,
+  * 		off before and after. Needs TILE_OE_TIM. Call LED_Tile_Set_Dimmer to go back to
+  * 		continuous output.
+  *
+  * @param  LED_Tile *tile, uint16_t width_us
+  * @retval uint8_t - 1 if the pulse was started, 0 if not (no nOE timer or a pulse still running)
+  */
+uint8_t LED_Tile_Strobe(LED_Tile *tile, uint16_t width_us){
+	if(tile->oe == NULL){
+		return 0;
+	}
+	return PCA9745_OE_Strobe(tile->oe, width_us);
+}
+
+/**
+  * @brief  Set Color of LED
+  * @note	Set the respective PWM register values of the RGB LED channels immediately. The
+  * 		framebuffer is updated to match.
+  *
+  * @param  LED_Tile *tile, uint16_t dev, uint8_t LED, uint8 red, uint8_t green, uint8_t blue
+  * @retval None
+  */
+void LED_Tile_Set_LED_Color(LED_Tile *tile, uint16_t dev, uint8_t LED, uint8_t red, uint8_t green, uint8_t blue){
+	uint8_t *f = tile->fb[dev].ch;
+	uint8_t *s = tile->sent[dev].ch;
+	f[TILE_LED_CH(LED, TILE_RED)] = s[TILE_LED_CH(LED, TILE_RED)] = red;
+	f[TILE_LED_CH(LED, TILE_GREEN)] = s[TILE_LED_CH(LED, TILE_GREEN)] = green;
+	f[TILE_LED_CH(LED, TILE_BLUE)] = s[TILE_LED_CH(LED, TILE_BLUE)] = blue;
+
+	PCA9745 *chain = LED_Tile_Get_Chain(tile, dev, &dev);
+	PCA9745_Set_PWMx(chain, dev, TILE_LED_CH(LED, TILE_RED), red);
+	PCA9745_Set_PWMx(chain, dev, TILE_LED_CH(LED, TILE_GREEN), green);
+	PCA9745_Set_PWMx(chain, dev, TILE_LED_CH(LED, TILE_BLUE), blue);
+}
+
+/**
+  * @brief  Set Color of LEDs on Each Tile
+  * @note	Set the respective PWM register values of the RGB LED channels
+  *
+  * @note	A grey (r == g == b) is broadcast with PWMALL, in one frame per chain, to the tiles
+  * 		whose IR channel already is at that level, so the IR LED never changes. The channels of
+  * 		the other tiles are staged and flushed together, at most 15 frames per chain.
+  *
+  * @param  LED_Tile *tile, uint8 red, uint8_t green, uint8_t blue
+  * @retval None
+  */
+void LED_Tile_Set_LED_Color_All(LED_Tile *tile, uint8_t r, uint8_t g, uint8_t b){
+	LED_Tile_Fill(tile, r, g, b);
+	for(uint16_t dev = 0; dev < tile->num_tiles; dev++){
+		for(uint8_t ch = 0; ch < 15; ch++){
+			tile->sent[dev].ch[ch] = tile->fb[dev].ch[ch];
+		}
+	}
+
+	if(r == g && g == b){
+		for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+			PCA9745 *chain = tile->chain[c];
+			uint16_t n = 0;
+			for(uint16_t dev = 0; dev < chain->num_dev; dev++){
+				uint8_t ir;
+				if(PCA9745_Get_Shadow(chain, dev, PWM15 - TILE_IR_CH, &ir) && ir == r){
+					commit_dev[n] = dev;
+					commit_data[n] = r;
+					n++;
 				}
 			}
+			PCA9745_Set_PWMALL_Multi(chain, commit_dev, commit_data, n);
 		}
+	}
 
-		//If random value is less than programmable chance, spawn a twinkle
-		if(rand() % TWINKLE_CHANCE < tile->twinkle.chance){
-			LED_Tile_Twinkle_Add(tile);
+	//Tiles set by the broadcast already hold these values in the shadow and are skipped
+	LED_Tile_Begin(tile);
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		PCA9745 *chain = tile->chain[c];
+		for(uint16_t dev = 0; dev < chain->num_dev; dev++){
+			for(uint8_t led = 0; led < TILE_NUM_LEDS; led++){
+				PCA9745_Set_PWMx(chain, dev, TILE_LED_CH(led, TILE_RED), r);
+				PCA9745_Set_PWMx(chain, dev, TILE_LED_CH(led, TILE_GREEN), g);
+				PCA9745_Set_PWMx(chain, dev, TILE_LED_CH(led, TILE_BLUE), b);
+			}
 		}
 	}
+	LED_Tile_Flush(tile);
 }
 
 /**
-  * @brief  Add a twinkle
-  * @note	Add a twinkle to the twinkles array. This function creates a twinkle and checks if there is already
-  * 		a twinkle at that location, then it will skip creating a twinkle.
+  * @brief  Set Color of LED
+  * @note	Set the respective IR register values of the IR LED channel
   *
-  * @note	If there is a space for a new twinkle available, create necessary decay values, RGB values and scale.
-  * 		In order to find the scale, a unity gain is found by using the maximum value of the decay function.
+  * @param  LED_Tile *tile, uint16_t dev, uint8_t value
+  * @retval None
+  */
+void LED_Tile_Set_IR_LED(LED_Tile *tile, uint16_t dev, uint8_t value){
+	tile->fb[dev].ch[TILE_IR_CH] = tile->sent[dev].ch[TILE_IR_CH] = value;
+	PCA9745 *chain = LED_Tile_Get_Chain(tile, dev, &dev);
+	PCA9745_Set_PWMx(chain, dev, TILE_IR_CH, value);
+}
+
+/**
+  * @brief  Clear All Color in Tile
+  * @note	Set the respective PWM register to zero with a single PWMALL write
   *
-  * @note	The decay values a_0 and a_1 are very important to determine the decay rate and shape of the twinkle.
-  * 		A couple of limitations to these two variables will determine the outcome of the decay function:
-  * 			a_1 != a_0, to guarantee exponential decay.
-  * 		The smaller the difference between a_0 and a_1, the slower the decay rate. Some decays may last up to
-  * 		30 seconds in the current configuration.
+  * @param  LED_Tile *tile, uint16_t dev
+  * @retval None
+  */
+void LED_Tile_Clear(LED_Tile *tile, uint16_t dev){
+	tile->fb[dev] = tile->sent[dev] = (LED_Tile_Pixels){0};
+	PCA9745 *chain = LED_Tile_Get_Chain(tile, dev, &dev);
+	PCA9745_Set_PWMALL(chain, dev, 0);
+}
+
+/**
+  * @brief  Clear All Color in All Tiles
+  * @note	Set the respective PWM register to zero, one PWMALL frame per chain
   *
   * @param  LED_Tile *tile
   * @retval None
   */
-void LED_Tile_Twinkle_Add(LED_Tile *tile){
-	uint16_t dev = rand() % NUM_TILES;
-	uint8_t led = rand() % 5;
-	uint8_t found = 0;
-	for(uint8_t i = 0; i < tile->twinkle.num; i++){
-		if(tile->twinkle.twinkles[i].dev == dev && tile->twinkle.twinkles[i].led == led && tile->twinkle.twinkles[i].active == 1){
-			found = 1;
-		}
+void LED_Tile_Clear_All(LED_Tile *tile){
+	for(uint16_t dev = 0; dev < tile->num_tiles; dev++){
+		tile->fb[dev] = tile->sent[dev] = (LED_Tile_Pixels){0};
 	}
-	if(found == 0){
-		for(uint8_t i = 0; i < tile->twinkle.num; i++){
-			if(tile->twinkle.twinkles[i].active == 0){	//If inactive twinkle within num of twinkles is found
-				tile->twinkle.twinkles[i].active = 1;
-				tile->twinkle.twinkles[i].dev = dev;
-				tile->twinkle.twinkles[i].led = led;
-				tile->twinkle.twinkles[i].t = 0.0f;
-				tile->twinkle.twinkles[i].r = rand() % 255;
-				tile->twinkle.twinkles[i].g = rand() % 255;
-				tile->twinkle.twinkles[i].b = rand() % 255;
-				tile->twinkle.twinkles[i].a_0 = (float)(rand() % 95 + 5) / 20.0f;
-				tile->twinkle.twinkles[i].a_1 = tile->twinkle.twinkles[i].a_0 + (float)(rand() % 99 + 1) / 20.0f;
-				tile->twinkle.twinkles[i].t_max = log(tile->twinkle.twinkles[i].a_1 / tile->twinkle.twinkles[i].a_0) / (tile->twinkle.twinkles[i].a_1 - tile->twinkle.twinkles[i].a_0);
-				tile->twinkle.twinkles[i].scale = 1.0f / f_brightness(tile->twinkle.twinkles[i].a_0, tile->twinkle.twinkles[i].a_1, tile->twinkle.twinkles[i].t_max);
-				break;
-			}
-		}
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		PCA9745_Set_PWMALL(tile->chain[c], PCA9745_ALL_DEVICES, 0);
+	}
+}
+
+/**
+  * @brief  Tests All Color in All Tiles
+  * @note	Tests red, green, blue values of all LEDs in all tiles
+  *
+  * @param  LED_Tile *tile
+  * @retval None
+  */
+void LED_Tile_Test_All(LED_Tile *tile){
+	for(uint8_t r = 0; r < 255; r++){
+		LED_Tile_Set_LED_Color_All(tile, r, 0, 0);
+		HAL_Delay(1);
+	}
+	for(uint8_t g = 0; g < 255; g++){
+		LED_Tile_Set_LED_Color_All(tile, 0, g, 0);
+		HAL_Delay(1);
+	}
+	for(uint8_t b = 0; b < 255; b++){
+		LED_Tile_Set_LED_Color_All(tile, 0, 0, b);
+		HAL_Delay(1);
 	}
 }
 
@@ -358,16 +870,38 @@ float f_dx(float x, float a, float b){
   * 			freq_max = 1 MHz
   * 			freq_min = 15.26 Hz
   *
-  * @param  LED_Tile *tile
+  * @param  LED_Tile *tile, float freq
   * @retval None
   */
 void Start_Update_Timer(LED_Tile *tile, float freq){
 	tile->update_timer.htim->Instance->PSC = (uint16_t) (tile->update_timer.tim_mhz - 1);
-	tile->update_timer.htim->Instance->ARR = (uint16_t) (tile->update_timer.tim_mhz * 1000000 / tile->update_timer.htim->Instance->PSC / freq - 1);
-	tile->update_timer.update_freq = freq;
+	Set_Update_Period(tile, (uint32_t) (1000000 / freq));
+	tile->update_timer.htim->Instance->EGR = TIM_EGR_UG;		//load PSC and ARR now
+	__HAL_TIM_CLEAR_FLAG(tile->update_timer.htim, TIM_FLAG_UPDATE);
 	HAL_TIM_Base_Start_IT(tile->update_timer.htim);
 }
 
+/**
+  * @brief  Set the Update Timer Period
+  * @note	Change the period of a running timer, in us of the 1MHz counter (16 - 65536). ARR is
+  * 		preloaded, so the current period finishes first and no update is lost or doubled.
+  *
+  * @param  LED_Tile *tile, uint32_t period_us
+  * @retval None
+  */
+void Set_Update_Period(LED_Tile *tile, uint32_t period_us){
+	if(period_us > 65536){
+		period_us = 65536;
+	}
+	else if(period_us < 16){
+		period_us = 16;
+	}
+	tile->update_timer.htim->Instance->CR1 |= TIM_CR1_ARPE;
+	tile->update_timer.htim->Instance->ARR = period_us - 1;
+	tile->update_timer.period_us = period_us;
+	tile->update_timer.update_freq = 1000000.0f / period_us;
+}
+
 /**
   * @brief  Stops the Update Timer
   *
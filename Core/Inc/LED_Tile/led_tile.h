@@ -10,6 +10,27 @@
 
 #include "main.h"
 #include "PCA9745/pca9745.h"
+#include "PCA9745/pca9745_diag.h"
+#include "PCA9745/pca9745_grad.h"
+#include "PCA9745/pca9745_oe.h"
+#include "PCA9745/pca9745_pump.h"
+
+//Build configuration, every value below can be overridden from the compiler command line.
+#ifndef TILE_NUM_CHAINS
+#define TILE_NUM_CHAINS	1		//1 - 3 independent chains, one per SPI bus, tiles split evenly
+#endif
+
+//Tiles over all chains, sizes every buffer indexed by the global tile index (~90 B per tile with
+//three layers, on top of ~15 KB for the pixel map and twinkle pool). The driver memory of each chain (PCA9745_Arena, PCA9745_Diag and PCA9745_Grad,
+//~180 B per device) is sized by PCA9745_MAX_DEV, so with more than one chain also set that to
+//the longest chain, e.g. -DTILE_NUM_CHAINS=3 -DPCA9745_MAX_DEV=64 -DTILE_MAX_TILES=192.
+//led_tile.c checks the total against TILE_RAM_BUDGET at compile time.
+#ifndef TILE_MAX_TILES
+#define TILE_MAX_TILES	(TILE_NUM_CHAINS * PCA9745_MAX_DEV)
+#endif
+#ifndef TILE_RAM_BUDGET
+#define TILE_RAM_BUDGET	(96 * 1024)	//of the 128 KB SRAM, the rest is left to the stack, USB and HAL
+#endif
 
 extern SPI_HandleTypeDef hspi1;
 
@@ -18,13 +39,119 @@ extern SPI_HandleTypeDef hspi1;
 #define TILE_CS_PIN		nCS_Pin
 #define TILE_OE_PORT	nOE_GPIO_Port
 #define TILE_OE_PIN		nOE_Pin
+#ifndef TILE_SPI_DMA
+#define TILE_SPI_DMA	1		//1 - non-blocking chain writes through HAL_SPI_Transmit_DMA
+#endif
+
+//nOE on a timer channel for LED_Tile_Set_Dimmer/LED_Tile_Strobe. Needs a board change, this
+//board cannot run it as is: PC4 has no timer function, so nOE must be reworked to a timer pin
+//(e.g. PC6, TIM3_CH1) with a pull-up and the other chains' nOE tied to it. The project has no
+//TIM3 either, add it in CubeMX on the new pin (PWM generation CH1) so htim3 and its clock enable
+//are generated, PCA9745_OE_Init does the rest of the timer setup. Compile checked only, it has
+//not run on hardware.
+#ifndef TILE_OE_TIM
+#define TILE_OE_TIM		0		//1 - nOE is driven by TILE_OE_HTIM, 0 - static GPIO
+#endif
+
+#if TILE_OE_TIM
+extern TIM_HandleTypeDef htim3;
+
+#define TILE_OE_HTIM		htim3
+#define TILE_OE_CHANNEL		TIM_CHANNEL_1
+#define TILE_OE_AF			GPIO_AF2_TIM3
+#define TILE_OE_TIM_MHZ		84
+#define TILE_OE_PERIOD_US	1000	//nOE PWM period, 1 kHz
+#endif
+
+//Timer driven frame pump, commits go out with no CPU between frames. Single chain only, the pump
+//has one slot timer and DMA stream, so TILE_NUM_CHAINS must be 1. Needs a board change, this
+//board cannot run it as is: PC5 has no timer function, so nCS must be reworked to a timer pin
+//(e.g. PA15, TIM2_CH1). The project has no TIM8 or TIM2 either, add both in CubeMX so htim8,
+//htim2 and their clock enables are generated, and have DMA2_Stream1_IRQHandler call
+//LED_Tile_Pump_IRQHandler. PCA9745_Pump_Init does the rest of the timer setup. Checked on the
+//host only (test_pump_replay), it has not run on hardware. The diagnostics reads wait for the
+//pump, set TILE_DIAG_BUDGET to 0 to keep the render free of them.
+#ifndef TILE_PUMP
+#define TILE_PUMP		0		//1 - LED_Tile_Commit sends through the frame pump
+#endif
+
+#if TILE_PUMP
+extern TIM_HandleTypeDef htim8;
+extern TIM_HandleTypeDef htim2;
+
+#define TILE_PUMP_SLOT_HTIM		htim8
+#define TILE_PUMP_CS_HTIM		htim2
+#define TILE_PUMP_CS_TRIGGER	TIM_TS_ITR1		//TIM8 TRGO on TIM2
+#define TILE_PUMP_CS_CHANNEL	TIM_CHANNEL_1
+#define TILE_PUMP_CS_AF			GPIO_AF1_TIM2
+#define TILE_PUMP_DMA			DMA2_Stream1	//TIM8_UP request
+#define TILE_PUMP_DMA_CHANNEL	DMA_CHANNEL_7
+#define TILE_PUMP_DMA_IRQn		DMA2_Stream1_IRQn
+#define TILE_PUMP_TIM_X			2		//slot timer clock / SPI clock source (PCLK2)
+#define TILE_PUMP_LEAD			8		//slot timer ticks from an nCS edge to the next byte
+#define TILE_PUMP_GUARD			32		//slot timer ticks of DMA latency allowed per byte
+#define TILE_PUMP_FRAMES		17		//frames per list, a commit is at most 16 PWMx + 1 PWMALL frames
+#endif
+
+//Camera synchronised IR strobe, see led_tile_ir.h. The frame sync goes to PA1 (TIM5_CH2), TIM5
+//timestamps it and its CH1 compare, the phase locked pulse, triggers the nOE timer through ITR2,
+//so this needs TILE_OE_TIM and its board change. The project has no TIM5 either, add it in CubeMX
+//(internal clock, TIM5 global interrupt) so htim5, its clock enable and TIM5_IRQHandler are
+//generated, and call LED_Tile_IR_IRQHandler from that handler. LED_Tile_IR_Start does the rest
+//of the timer setup. The PLL is checked on the host (test_ir_pll), the timer path is compile
+//checked only and has not run on hardware.
+#ifndef TILE_IR_SYNC
+#define TILE_IR_SYNC	0		//1 - LED_Tile_IR_Start available
+#endif
+
+#if TILE_IR_SYNC
+extern TIM_HandleTypeDef htim5;
+
+#define TILE_IR_HTIM		htim5			//32 bit, counts us
+#define TILE_IR_TIM_MHZ		84
+#define TILE_IR_SYNC_CHANNEL	TIM_CHANNEL_2
+#define TILE_IR_SYNC_PORT	GPIOA
+#define TILE_IR_SYNC_PIN	GPIO_PIN_1
+#define TILE_IR_SYNC_AF		GPIO_AF2_TIM5
+#define TILE_IR_SYNC_EDGE	TIM_INPUTCHANNELPOLARITY_RISING
+#define TILE_IR_TRIGGER		TIM_TS_ITR2		//TIM5 TRGO on TIM3
+#define TILE_IR_IRQn		TIM5_IRQn
+#endif
+
+//Additional chains: SPI2 (PB13-15, DMA1 stream 3/4) with nCS1/nOE1 on PD9/PD8 and SPI3 (PC10-12,
+//DMA1 stream 0/5) with nCS2/nOE2 on PD11/PD10, set up in main.c like SPI1
+#if TILE_NUM_CHAINS > 1
+extern SPI_HandleTypeDef hspi2;
+
+#define TILE_SPI_1		hspi2
+#define TILE_CS_PORT_1	nCS1_GPIO_Port
+#define TILE_CS_PIN_1	nCS1_Pin
+#define TILE_OE_PORT_1	nOE1_GPIO_Port
+#define TILE_OE_PIN_1	nOE1_Pin
+#endif
+
+#if TILE_NUM_CHAINS > 2
+extern SPI_HandleTypeDef hspi3;
+
+#define TILE_SPI_2		hspi3
+#define TILE_CS_PORT_2	nCS2_GPIO_Port
+#define TILE_CS_PIN_2	nCS2_Pin
+#define TILE_OE_PORT_2	nOE2_GPIO_Port
+#define TILE_OE_PIN_2	nOE2_Pin
+#endif
 
 extern TIM_HandleTypeDef htim1;
 
 #define TILE_TIM		htim1
 #define TILE_TIM_MHZ	84
 
-#define NUM_TILES 2
+#ifndef TILE_DIAG_BUDGET
+#define TILE_DIAG_BUDGET	1	//diagnostics registers per chain per update (budget + 1 read frames), 0 - disabled
+#endif
+
+#ifndef NUM_TILES
+#define NUM_TILES 2		//default chain length, see LED_Tile_Set_Num_Tiles
+#endif
 #define R_EXT 3600.0f
 #define MAX_INTESITY 2.25f
 
@@ -37,62 +164,126 @@ extern TIM_HandleTypeDef htim1;
 #define IR_A 0.0f
 #define IR_B 0.1125f
 
-#define TWINKLE_NUM_MAX 	5
-#define TWINKLE_CHANCE 		10000
+#define TILE_IREF_LUT_BITS	6		//2^n segments between 0 and MAX_INTESITY
+#define TILE_IREF_LUT_SIZE	(1 << TILE_IREF_LUT_BITS)
+
+typedef enum {
+	TILE_RED,
+	TILE_GREEN,
+	TILE_BLUE,
+	TILE_IR,
+	TILE_NUM_COLORS
+} LED_Tile_Color;
 
 typedef struct {
 	uint8_t brightness;
 	uint8_t instruction;
 } UV_LED;
 
-typedef struct {
-	uint8_t r, g, b;
-	float a_0, a_1;
-	float scale;
-	float t;
-	float t_max;
-	uint8_t active;
-	uint16_t dev;
-	uint8_t led;
-} RGB_LED;
+#define TILE_NUM_LEDS		5									//RGB LEDs per tile
+#define TILE_LED_CH(led, color)	((led) * 3 + (color))		//channel of a colour of an RGB LED
+#define TILE_IR_CH			15									//channel of the IR LED
+
+//PWM value of every channel of a tile, LED n is ch[n * 3 + 0..2] (R, G, B) and the IR LED is ch[15]
+typedef union {
+	uint8_t ch[16];
+	uint32_t w[4];
+} LED_Tile_Pixels;
+
+struct LED_Tile_Effect;
+struct LED_Tile_Map;
 
 typedef struct {
-	PCA9745 *p;
+	PCA9745 *p;							//First chain
+	PCA9745 *chain[TILE_NUM_CHAINS];
+	uint16_t chain_start[TILE_NUM_CHAINS];	//Global index of each chain's first tile
+	uint16_t num_tiles;
+	PCA9745_Diag *diag[TILE_NUM_CHAINS];	//Background MODE2/EFLAG scanner per chain
+	PCA9745_Grad *grad[TILE_NUM_CHAINS];	//Gradation group allocator per chain
+	PCA9745_OE_Timer *oe;				//nOE timer of the first chain, NULL - TILE_OE_TIM is 0
+	PCA9745_Pump *pump;					//frame pump of the first chain, NULL - TILE_PUMP is 0
+
+	//Framebuffer, one entry per tile by global index
+	LED_Tile_Pixels *fb;				//rendered by effects, sent by LED_Tile_Commit
+	LED_Tile_Pixels *sent;				//last values sent to the tiles
+	uint8_t resync;						//1 - sent[] is unknown, compare every channel on next commit
+	const struct LED_Tile_Map *map;		//pixel geometry, see led_tile_map.h, NULL - none built
+
+	//Global dimming, see LED_Tile_Set_Master
+	uint8_t master;						//GRPPWM duty while not blinking
+
+	//IREF code per colour in Q8, TILE_IREF_LUT_SIZE + 1 points from 0 to MAX_INTESITY
+	uint16_t iref_lut[TILE_NUM_COLORS][TILE_IREF_LUT_SIZE + 1];
 
 	//Timer Variables
 	struct {
 		TIM_HandleTypeDef *htim;
 		uint8_t tim_mhz;
 		float update_freq;
+		uint32_t period_us;			//(ARR + 1), the counter runs at 1 MHz
 	} update_timer;
 
-	//Twinkle Variables
+	//Effect Variables, see led_tile_fx.h
 	struct {
-		RGB_LED twinkles[TWINKLE_NUM_MAX];
-		uint8_t en;
-		uint16_t chance;	// x / 1000 chance to spawn a twinkle
-		float time_step;	// controls the decay rate
-		uint8_t num;
-	} twinkle;
+		const struct LED_Tile_Effect *active;			//rendered on every update
+		const struct LED_Tile_Effect * volatile pending;	//replaces active on the next update
+		uint32_t dt_us;									//time step passed to render
+		uint8_t en;										//1 - the update timer is rendering
+		volatile uint32_t ticks;						//update timer periods, counted by LED_Tile_FX_Tick
+		volatile uint32_t tick_stamp;					//DWT->CYCCNT of the last tick, the frame's release time
+		uint32_t frames;								//ticks handled by LED_Tile_FX_Update
+		uint32_t isr_cycles;							//longest update interrupt, set by its IRQ handler
+		uint32_t render_cycles;							//longest LED_Tile_FX_Update
+
+		//Scheduler, see LED_Tile_FX_Set_Policy
+		uint32_t frame_start, frame_end;				//DWT->CYCCNT of the last frame
+		uint32_t load_cycles;							//average frame length, 1/8 per frame
+		uint32_t missed;								//frames that ended after the next tick was due
+		uint32_t dropped;								//ticks merged into a later frame
+		uint32_t target_us;								//period requested with LED_Tile_FX_Start
+		uint8_t policy;									//TILE_FX_DROP or TILE_FX_STRETCH
+		uint8_t adapt;									//1 - lengthen the period while frames do not fit
+	} fx;
 } LED_Tile;
 
-LED_Tile Init_LED_Tile();
+LED_Tile Init_LED_Tile(uint16_t num_tiles);
+void LED_Tile_Set_Num_Tiles(LED_Tile *tile, uint16_t num_tiles);
+uint8_t LED_Tile_Get_Chain_Index(LED_Tile *tile, uint16_t tile_index, uint16_t *dev);
+PCA9745 *LED_Tile_Get_Chain(LED_Tile *tile, uint16_t tile_index, uint16_t *dev);
+void LED_Tile_Begin(LED_Tile *tile);
+uint16_t LED_Tile_Flush(LED_Tile *tile);
+void LED_Tile_SPI_Complete(LED_Tile *tile, SPI_HandleTypeDef *hspi);
+void LED_Tile_Diag_Step(LED_Tile *tile);
+uint8_t LED_Tile_Get_Status(LED_Tile *tile, uint16_t dev, PCA9745_Diag_Status *s);
+uint8_t LED_Tile_Fade_LED(LED_Tile *tile, uint16_t dev, uint8_t LED, uint8_t red, uint8_t green, uint8_t blue, uint32_t ramp_ms, uint32_t hold_ms);
+void LED_Tile_Fade_Release(LED_Tile *tile, uint16_t dev, uint8_t LED);
+void LED_Tile_Draw_LED(LED_Tile *tile, uint16_t dev, uint8_t LED, uint8_t red, uint8_t green, uint8_t blue);
+void LED_Tile_Draw_IR(LED_Tile *tile, uint16_t dev, uint8_t value);
+void LED_Tile_Fill(LED_Tile *tile, uint8_t r, uint8_t g, uint8_t b);
+uint16_t LED_Tile_Commit(LED_Tile *tile);
+void LED_Tile_Pump_IRQHandler(LED_Tile *tile);
+void LED_Tile_Build_IREF_LUT(LED_Tile *tile, LED_Tile_Color color, float a, float b);
+uint16_t LED_Tile_Intensity_Level(float intensity);
+uint8_t LED_Tile_IREF_Code(LED_Tile *tile, LED_Tile_Color color, uint16_t level);
+void LED_Tile_Benchmark_IREF(LED_Tile *tile, uint32_t *solver_cycles, uint32_t *lut_cycles, uint8_t *max_error);
 void LED_Tile_Set_LED_Intensity(LED_Tile *tile, uint16_t dev, uint8_t LED, float intensity);
+void LED_Tile_Set_Intensity_All(LED_Tile *tile, float intensity);
+void LED_Tile_Set_Master(LED_Tile *tile, uint8_t level);
+void LED_Tile_Set_Blink(LED_Tile *tile, uint32_t period_ms, uint8_t duty);
+void LED_Tile_Set_Dimmer(LED_Tile *tile, uint16_t duty);
+uint8_t LED_Tile_Strobe(LED_Tile *tile, uint16_t width_us);
 void LED_Tile_Set_LED_Color(LED_Tile *tile, uint16_t dev, uint8_t LED, uint8_t red, uint8_t green, uint8_t blue);
+void LED_Tile_Set_LED_Color_All(LED_Tile *tile, uint8_t r, uint8_t g, uint8_t b);
 void LED_Tile_Set_IR_LED(LED_Tile *tile, uint16_t dev, uint8_t value);
 void LED_Tile_Clear(LED_Tile *tile, uint16_t dev);
 void LED_Tile_Clear_All(LED_Tile *tile);
 void LED_Tile_Test_All(LED_Tile *tile);
-void LED_Tile_Twinkle_Init(LED_Tile *tile, uint16_t chance, uint8_t num);
-void LED_Tile_Twinkle_Start(LED_Tile *tile, float freq);
-void LED_Tile_Twinkle_Stop(LED_Tile *tile);
-void LED_Tile_Twinkle_Update(LED_Tile *tile);
-void LED_Tile_Twinkle_Add(LED_Tile *tile);
 float f_brightness(float a, float b, float t);
 float Get_Intensity(float intensity, float a, float b);
 float f_x(float x, float a, float b, float c);
 float f_dx(float x, float a, float b);
 void Start_Update_Timer(LED_Tile *tile, float freq);
+void Set_Update_Period(LED_Tile *tile, uint32_t period_us);
 void Stop_Update_Timer(LED_Tile *tile);
 
 #endif /* INC_LED_TILE_LED_TILE_H_ */
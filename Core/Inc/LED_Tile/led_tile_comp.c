@@ -0,0 +1,283 @@
+/*
+ * led_tile_comp.c
+ *
+ *  Created on: Jun 25, 2021
+ *      Author: THollis
+ */
+
+#include "main.h"
+#include "led_tile.h"
+#include "led_tile_comp.h"
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#define TILE_COMP_SIMD	1		//Cortex-M4 packed 8-bit kernels
+#else
+#define TILE_COMP_SIMD	0		//portable scalar kernels, e.g. host builds
+#endif
+
+#define TILE_COMP_WORDS	(TILE_MAX_TILES * 4)
+#define TILE_COMP_BENCH	((TILE_COMP_WORDS / 3) & ~3UL)	//benchmark source and two outputs share one layer buffer
+
+static void _LED_Tile_Layers_Init(LED_Tile *tile, void *state, uint32_t dt_us);
+static void _LED_Tile_Layers_Render(LED_Tile *tile, void *state, uint32_t dt_us);
+static void _LED_Tile_Layers_Teardown(LED_Tile *tile, void *state);
+
+static LED_Tile_Pixels layer_fb[TILE_NUM_LAYERS][TILE_MAX_TILES];
+
+static LED_Tile_Layer layers[TILE_NUM_LAYERS] = {
+	{ .buf = layer_fb[0] },
+#if TILE_NUM_LAYERS > 1
+	{ .buf = layer_fb[1] },
+#endif
+#if TILE_NUM_LAYERS > 2
+	{ .buf = layer_fb[2] },
+#endif
+#if TILE_NUM_LAYERS > 3
+	{ .buf = layer_fb[3] },
+#endif
+};
+
+const LED_Tile_Effect LED_Tile_FX_Layers = {
+	.name = "layers",
+	.state = layers,
+	.init = _LED_Tile_Layers_Init,
+	.render = _LED_Tile_Layers_Render,
+	.teardown = _LED_Tile_Layers_Teardown,
+};
+
+//Layer alpha 0 - 255 as a weight of 0 - 256, so 255 copies the layer exactly
+static inline uint32_t _LED_Tile_Alpha_Weight(uint8_t alpha){
+	return alpha + (alpha >> 7);
+}
+
+/**
+  * @brief  Blend Buffers, Scalar
+  * @note	Reference kernels, one channel at a time. Used when the core has no DSP extension
+  * 		and as the baseline of LED_Tile_Comp_Benchmark. The results are bit exact with
+  * 		LED_Tile_Comp_Blend.
+  *
+  * @param  uint32_t *dst, const uint32_t *src, uint16_t n (words), LED_Tile_Blend mode, uint8_t alpha
+  * @retval None
+  */
+void LED_Tile_Comp_Blend_Scalar(uint32_t *dst, const uint32_t *src, uint16_t n, LED_Tile_Blend mode, uint8_t alpha){
+	uint8_t *d = (uint8_t *)dst;
+	const uint8_t *s = (const uint8_t *)src;
+	uint32_t a = _LED_Tile_Alpha_Weight(alpha);
+
+	for(uint32_t i = 0; i < n * 4UL; i++){
+		uint32_t v;
+		switch(mode){
+		case TILE_BLEND_ADD:
+			v = d[i] + s[i];
+			d[i] = (v > 0xFF) ? 0xFF : v;
+			break;
+		case TILE_BLEND_MAX:
+			d[i] = (s[i] > d[i]) ? s[i] : d[i];
+			break;
+		default:
+			d[i] = (d[i] * (256 - a) + s[i] * a) >> 8;
+			break;
+		}
+	}
+}
+
+/**
+  * @brief  Blend Buffers
+  * @note	Blend n words of src into dst, four channels per word. On the Cortex-M4 every mode
+  * 		works on all four 8-bit lanes at once:
+  * 			TILE_BLEND_ADD		__UQADD8
+  * 			TILE_BLEND_MAX		__USUB8 sets the GE flag of each lane where dst >= src, __SEL picks by lane
+  * 			TILE_BLEND_ALPHA	__UXTB16 splits even and odd lanes into 16-bit halves, one MUL/MLA pair
+  * 								weighs two channels and the >> 8 of each half lands in its byte
+  *
+  * @note	dst * (256 - a) + src * a is at most 255 * 256, so the two halves of the alpha multiply
+  * 		never carry into each other.
+  *
+  * @param  uint32_t *dst, const uint32_t *src, uint16_t n (words), LED_Tile_Blend mode, uint8_t alpha
+  * @retval None
+  */
+void LED_Tile_Comp_Blend(uint32_t *dst, const uint32_t *src, uint16_t n, LED_Tile_Blend mode, uint8_t alpha){
+#if TILE_COMP_SIMD
+	uint32_t a = _LED_Tile_Alpha_Weight(alpha);
+	uint32_t inv = 256 - a;
+
+	switch(mode){
+	case TILE_BLEND_ADD:
+		for(uint16_t i = 0; i < n; i++){
+			dst[i] = __UQADD8(dst[i], src[i]);
+		}
+		break;
+	case TILE_BLEND_MAX:
+		for(uint16_t i = 0; i < n; i++){
+			__USUB8(dst[i], src[i]);
+			dst[i] = __SEL(dst[i], src[i]);
+		}
+		break;
+	default:
+		for(uint16_t i = 0; i < n; i++){
+			uint32_t d = dst[i], s = src[i];
+			uint32_t even = __UXTB16(d) * inv + __UXTB16(s) * a;
+			uint32_t odd = __UXTB16(__ROR(d, 8)) * inv + __UXTB16(__ROR(s, 8)) * a;
+			dst[i] = ((even >> 8) & 0x00FF00FFUL) | (odd & 0xFF00FF00UL);
+		}
+		break;
+	}
+#else
+	LED_Tile_Comp_Blend_Scalar(dst, src, n, mode, alpha);
+#endif
+}
+
+/**
+  * @brief  Set a Layer
+  * @note	Put an effect on a layer, layer 0 is at the bottom. Every layer renders into its own
+  * 		buffer and the buffers are blended bottom up into the framebuffer, so the bus only sees
+  * 		the final colour. Effects keep their state in one static instance, so an effect can be
+  * 		on one layer only. fx = NULL removes the layer.
+  *
+  * @note	Set the layers before selecting LED_Tile_FX_Layers, the layer effects are initialized
+  * 		when it is selected. The alpha can be changed at any time with LED_Tile_Layer_Set_Alpha.
+  *
+  * @param  uint8_t layer, const LED_Tile_Effect *fx, LED_Tile_Blend mode, uint8_t alpha
+  * @retval uint8_t - 1 on success, 0 if the layer or mode does not exist
+  */
+uint8_t LED_Tile_Layer_Set(uint8_t layer, const LED_Tile_Effect *fx, LED_Tile_Blend mode, uint8_t alpha){
+	if(layer >= TILE_NUM_LAYERS || mode >= TILE_NUM_BLENDS){
+		return 0;
+	}
+	layers[layer].fx = fx;
+	layers[layer].mode = mode;
+	layers[layer].alpha = alpha;
+	return 1;
+}
+
+/**
+  * @brief  Set Layer Alpha
+  *
+  * @param  uint8_t layer, uint8_t alpha
+  * @retval None
+  */
+void LED_Tile_Layer_Set_Alpha(uint8_t layer, uint8_t alpha){
+	if(layer < TILE_NUM_LAYERS){
+		layers[layer].alpha = alpha;
+	}
+}
+
+//Point the framebuffer at each layer in turn and call the layer effect's callback
+static void _LED_Tile_Layers_Call(LED_Tile *tile, LED_Tile_Layer *l, uint32_t dt_us, uint8_t stage){
+	LED_Tile_Pixels *fb = tile->fb;
+	for(uint8_t i = 0; i < TILE_NUM_LAYERS; i++){
+		if(l[i].fx == NULL){
+			continue;
+		}
+		tile->fb = l[i].buf;
+		if(stage == 0 && l[i].fx->init != NULL){
+			l[i].fx->init(tile, l[i].fx->state, dt_us);
+		}
+		else if(stage == 1 && l[i].fx->render != NULL){
+			l[i].fx->render(tile, l[i].fx->state, dt_us);
+		}
+		else if(stage == 2 && l[i].fx->teardown != NULL){
+			l[i].fx->teardown(tile, l[i].fx->state);
+		}
+	}
+	tile->fb = fb;
+}
+
+//Blend the layer buffers bottom up into the framebuffer
+static void _LED_Tile_Layers_Composite(LED_Tile *tile, LED_Tile_Layer *l){
+	uint16_t n = tile->num_tiles * 4;
+	for(uint16_t i = 0; i < tile->num_tiles; i++){
+		tile->fb[i] = (LED_Tile_Pixels){0};
+	}
+	for(uint8_t i = 0; i < TILE_NUM_LAYERS; i++){
+		if(l[i].fx != NULL){
+			LED_Tile_Comp_Blend(tile->fb[0].w, l[i].buf[0].w, n, l[i].mode, l[i].alpha);
+		}
+	}
+}
+
+/**
+  * @brief  Initialize the Layer Stack
+  * @note	Effect init. Clears the layer buffers and initializes every layer effect.
+  *
+  * @param  LED_Tile *tile, void *state, uint32_t dt_us
+  * @retval None
+  */
+static void _LED_Tile_Layers_Init(LED_Tile *tile, void *state, uint32_t dt_us){
+	LED_Tile_Layer *l = state;
+	for(uint8_t i = 0; i < TILE_NUM_LAYERS; i++){
+		for(uint16_t dev = 0; dev < TILE_MAX_TILES; dev++){
+			l[i].buf[dev] = (LED_Tile_Pixels){0};
+		}
+	}
+	_LED_Tile_Layers_Call(tile, l, dt_us, 0);
+}
+
+/**
+  * @brief  Render the Layer Stack
+  * @note	Effect render. Every layer effect renders into its own buffer, then the buffers are
+  * 		composited into the framebuffer, which the pipeline commits once.
+  *
+  * @param  LED_Tile *tile, void *state, uint32_t dt_us
+  * @retval None
+  */
+static void _LED_Tile_Layers_Render(LED_Tile *tile, void *state, uint32_t dt_us){
+	_LED_Tile_Layers_Call(tile, state, dt_us, 1);
+	_LED_Tile_Layers_Composite(tile, state);
+}
+
+/**
+  * @brief  Stop the Layer Stack
+  * @note	Effect teardown. Tears down every layer effect and composites what they leave behind.
+  *
+  * @param  LED_Tile *tile, void *state
+  * @retval None
+  */
+static void _LED_Tile_Layers_Teardown(LED_Tile *tile, void *state){
+	_LED_Tile_Layers_Call(tile, state, 0, 2);
+	_LED_Tile_Layers_Composite(tile, state);
+}
+
+/**
+  * @brief  Benchmark the Compositor
+  * @note	Blend a third of a layer buffer of pseudo-random channels with every mode using
+  * 		LED_Tile_Comp_Blend and LED_Tile_Comp_Blend_Scalar, and measure the cycles per tile of
+  * 		each with the DWT cycle counter. The first layer buffer is used as scratch, so do not
+  * 		run it while LED_Tile_FX_Layers is active.
+  *
+  * @param  uint32_t *simd_cycles, uint32_t *scalar_cycles (TILE_NUM_BLENDS entries each)
+  * @retval uint16_t - words where the two kernels disagree, 0 expected
+  */
+uint16_t LED_Tile_Comp_Benchmark(uint32_t *simd_cycles, uint32_t *scalar_cycles){
+	uint32_t *src = layer_fb[0][0].w;
+	uint32_t *simd = src + TILE_COMP_BENCH;
+	uint32_t *scalar = simd + TILE_COMP_BENCH;
+	uint32_t x = 0x2545F491UL, start;
+	uint16_t mismatch = 0;
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	for(uint8_t mode = 0; mode < TILE_NUM_BLENDS; mode++){
+		for(uint32_t i = 0; i < TILE_COMP_BENCH; i++){
+			//xorshift32, only needs to cover every lane value
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			src[i] = x;
+			simd[i] = scalar[i] = __builtin_bswap32(x) ^ 0x5A5A5A5AUL;
+		}
+
+		start = DWT->CYCCNT;
+		LED_Tile_Comp_Blend(simd, src, TILE_COMP_BENCH, mode, 0x60);
+		simd_cycles[mode] = (DWT->CYCCNT - start) / (TILE_COMP_BENCH / 4);
+
+		start = DWT->CYCCNT;
+		LED_Tile_Comp_Blend_Scalar(scalar, src, TILE_COMP_BENCH, mode, 0x60);
+		scalar_cycles[mode] = (DWT->CYCCNT - start) / (TILE_COMP_BENCH / 4);
+
+		for(uint32_t i = 0; i < TILE_COMP_BENCH; i++){
+			mismatch += (simd[i] != scalar[i]);
+		}
+	}
+	return mismatch;
+}
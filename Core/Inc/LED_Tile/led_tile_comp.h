@@ -0,0 +1,41 @@
+/*
+ * led_tile_comp.h
+ *
+ *  Created on: Jun 25, 2021
+ *      Author: THollis
+ */
+
+#ifndef INC_LED_TILE_LED_TILE_COMP_H_
+#define INC_LED_TILE_LED_TILE_COMP_H_
+
+#include "main.h"
+#include "led_tile.h"
+#include "led_tile_fx.h"
+
+#ifndef TILE_NUM_LAYERS
+#define TILE_NUM_LAYERS	3		//layers of LED_Tile_FX_Layers, each costs a framebuffer
+#endif
+
+typedef enum {
+	TILE_BLEND_ALPHA,		//out = out * (1 - alpha) + layer * alpha
+	TILE_BLEND_ADD,			//out = out + layer, saturated
+	TILE_BLEND_MAX,			//out = max(out, layer)
+	TILE_NUM_BLENDS
+} LED_Tile_Blend;
+
+typedef struct {
+	const LED_Tile_Effect *fx;		//NULL - layer unused
+	LED_Tile_Pixels *buf;			//rendered by fx, one entry per tile
+	LED_Tile_Blend mode;
+	uint8_t alpha;					//0 - 255, TILE_BLEND_ALPHA only
+} LED_Tile_Layer;
+
+extern const LED_Tile_Effect LED_Tile_FX_Layers;
+
+uint8_t LED_Tile_Layer_Set(uint8_t layer, const LED_Tile_Effect *fx, LED_Tile_Blend mode, uint8_t alpha);
+void LED_Tile_Layer_Set_Alpha(uint8_t layer, uint8_t alpha);
+void LED_Tile_Comp_Blend(uint32_t *dst, const uint32_t *src, uint16_t n, LED_Tile_Blend mode, uint8_t alpha);
+void LED_Tile_Comp_Blend_Scalar(uint32_t *dst, const uint32_t *src, uint16_t n, LED_Tile_Blend mode, uint8_t alpha);
+uint16_t LED_Tile_Comp_Benchmark(uint32_t *simd_cycles, uint32_t *scalar_cycles);
+
+#endif /* INC_LED_TILE_LED_TILE_COMP_H_ */
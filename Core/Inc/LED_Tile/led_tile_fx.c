@@ -0,0 +1,259 @@
+/*
+ * led_tile_fx.c
+ *
+ *  Created on: Jun 25, 2021
+ *      Author: THollis
+ */
+
+#include "main.h"
+#include "led_tile.h"
+#include "led_tile_fx.h"
+
+static const LED_Tile_Effect *fx_registry[TILE_FX_MAX];
+static uint8_t fx_count = 0;
+
+/**
+  * @brief  Register an Effect
+  * @note	Add an effect to the registry. The id returned is used with LED_Tile_FX_Select.
+  * 		Registering the same effect twice returns its existing id.
+  *
+  * @param  const LED_Tile_Effect *fx
+  * @retval int8_t - effect id, -1 if the registry is full
+  */
+int8_t LED_Tile_FX_Register(const LED_Tile_Effect *fx){
+	for(uint8_t id = 0; id < fx_count; id++){
+		if(fx_registry[id] == fx){
+			return id;
+		}
+	}
+	if(fx_count >= TILE_FX_MAX){
+		return -1;
+	}
+	fx_registry[fx_count] = fx;
+	return fx_count++;
+}
+
+/**
+  * @brief  Number of Registered Effects
+  *
+  * @param  None
+  * @retval uint8_t
+  */
+uint8_t LED_Tile_FX_Count(void){
+	return fx_count;
+}
+
+/**
+  * @brief  Get a Registered Effect
+  *
+  * @param  uint8_t id
+  * @retval const LED_Tile_Effect * - NULL if id is not registered
+  */
+const LED_Tile_Effect *LED_Tile_FX_Get(uint8_t id){
+	return (id < fx_count) ? fx_registry[id] : NULL;
+}
+
+/**
+  * @brief  Select an Effect
+  * @note	Initialize the effect in thread mode and hand it to the pipeline. While the update timer
+  * 		is running, the current effect keeps rendering and the switch (teardown of the old effect,
+  * 		first render of the new one) happens at the start of the next update, so the timer is
+  * 		never stopped. Selecting the effect that is already active only cancels a pending switch.
+  *
+  * @note	The render task (PendSV) is masked with BASEPRI while the init runs, as the new effect
+  * 		may share state with the running one (e.g. a layer of LED_Tile_FX_Layers). Ticks keep
+  * 		being counted, so a frame that falls due meanwhile is only delayed.
+  *
+  * @note	Call from thread mode only.
+  *
+  * @param  LED_Tile *tile, uint8_t id
+  * @retval uint8_t - 1 on success, 0 if id is not registered
+  */
+uint8_t LED_Tile_FX_Select(LED_Tile *tile, uint8_t id){
+	const LED_Tile_Effect *fx = LED_Tile_FX_Get(id);
+	if(fx == NULL){
+		return 0;
+	}
+	if(fx == tile->fx.active){
+		tile->fx.pending = NULL;
+		return 1;
+	}
+
+	tile->fx.pending = NULL;		//a switch not yet taken is dropped
+	uint32_t basepri = __get_BASEPRI();
+	__set_BASEPRI(TILE_FX_PRIO << (8 - __NVIC_PRIO_BITS));
+	if(fx->init != NULL){
+		fx->init(tile, fx->state, tile->fx.dt_us);
+	}
+	if(tile->fx.en == 1){
+		tile->fx.pending = fx;
+	}
+	else{
+		if(tile->fx.active != NULL && tile->fx.active->teardown != NULL){
+			tile->fx.active->teardown(tile, tile->fx.active->state);
+		}
+		tile->fx.active = fx;
+		LED_Tile_Commit(tile);
+	}
+	__set_BASEPRI(basepri);
+	return 1;
+}
+
+/**
+  * @brief  Start Rendering Effects
+  * @note	Re-initialize the active effect for the new time step and start the update timer.
+  * 		Call LED_Tile_FX_Tick from the timer's period elapsed callback and LED_Tile_FX_Update
+  * 		from PendSV_Handler.
+  *
+  * @param  LED_Tile *tile, float freq
+  * @retval None
+  */
+void LED_Tile_FX_Start(LED_Tile *tile, float freq){
+	tile->fx.dt_us = (uint32_t)(1000000.0f / freq);
+	tile->fx.target_us = tile->fx.dt_us;
+	tile->fx.load_cycles = 0;
+	if(tile->fx.active != NULL && tile->fx.active->init != NULL){
+		tile->fx.active->init(tile, tile->fx.active->state, tile->fx.dt_us);
+	}
+	tile->fx.frames = tile->fx.ticks;
+	tile->fx.en = 1;
+	Start_Update_Timer(tile, freq);
+}
+
+/**
+  * @brief  Set the Scheduling Policy
+  * @note	Choose what happens when a frame takes longer than the update period. Late ticks are
+  * 		always merged into the next frame and counted in tile->fx.dropped, a frame ending
+  * 		after the next tick was due is counted in tile->fx.missed.
+  * 			TILE_FX_DROP		effects get the real time since the last frame as dt, animations
+  * 								keep their speed at a lower frame rate
+  * 			TILE_FX_STRETCH		effects always get the nominal dt, animations slow down instead
+  *
+  * @note	With adapt = 1 the update period follows the average frame length plus 1/TILE_FX_HEADROOM,
+  * 		so a chain too long for the requested rate runs at the highest rate it can keep instead of
+  * 		missing every other deadline. It returns to the requested rate when the load drops.
+  *
+  * @param  LED_Tile *tile, LED_Tile_FX_Policy policy, uint8_t adapt
+  * @retval None
+  */
+void LED_Tile_FX_Set_Policy(LED_Tile *tile, LED_Tile_FX_Policy policy, uint8_t adapt){
+	tile->fx.policy = policy;
+	tile->fx.adapt = adapt;
+	if(!adapt && tile->fx.en == 1){
+		Set_Update_Period(tile, tile->fx.target_us);
+	}
+}
+
+//Lengthen the period while the average frame does not fit, shorten it back towards the target
+static void _LED_Tile_FX_Adapt(LED_Tile *tile){
+	uint32_t need_us = tile->fx.load_cycles / (SystemCoreClock / 1000000);
+	uint32_t period_us = tile->update_timer.period_us;
+	need_us += need_us / TILE_FX_HEADROOM;
+
+	if(need_us > period_us){
+		Set_Update_Period(tile, need_us + need_us / 8);
+	}
+	else if(period_us > tile->fx.target_us && need_us + need_us / 4 < period_us){
+		Set_Update_Period(tile, (need_us + need_us / 8 > tile->fx.target_us) ? need_us + need_us / 8 : tile->fx.target_us);
+	}
+}
+
+/**
+  * @brief  Stop Rendering Effects
+  * @note	Stop the update timer and tear down the active effect. Whatever the teardown leaves in
+  * 		the framebuffer is committed.
+  *
+  * @param  LED_Tile *tile
+  * @retval None
+  */
+void LED_Tile_FX_Stop(LED_Tile *tile){
+	Stop_Update_Timer(tile);
+	tile->fx.en = 0;
+	if(tile->fx.pending != NULL){
+		tile->fx.active = tile->fx.pending;
+		tile->fx.pending = NULL;
+	}
+	if(tile->fx.active != NULL && tile->fx.active->teardown != NULL){
+		tile->fx.active->teardown(tile, tile->fx.active->state);
+	}
+	LED_Tile_Commit(tile);
+}
+
+/**
+  * @brief  Update Timer Tick
+  * @note	Count the period and pend PendSV, which renders the frame in LED_Tile_FX_Update.
+  * 		This is all the update interrupt does, so its worst case is a few dozen cycles and
+  * 		USB, DMA and the buttons are never held off by a frame. PendSV must have the lowest
+  * 		priority of all interrupts.
+  *
+  * @note	The whole update interrupt, HAL dispatch included, is timed in TIM1_UP_TIM10_IRQHandler
+  * 		into tile->fx.isr_cycles.
+  *
+  * @param  LED_Tile *tile
+  * @retval None
+  */
+void LED_Tile_FX_Tick(LED_Tile *tile){
+	tile->fx.tick_stamp = DWT->CYCCNT;
+	tile->fx.ticks++;
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+/**
+  * @brief  Render One Frame
+  * @note	Take a pending effect switch, render the active effect into the framebuffer, commit the
+  * 		frame in one batch and give the diagnostics scanner its slot. Call from PendSV_Handler,
+  * 		where it may be preempted by every other interrupt, including the SPI DMA completion
+  * 		it waits on.
+  *
+  * @note	Only renders if LED_Tile_FX_Tick has counted a period since the last frame, so PendSV
+  * 		can be pended for other deferred work. Ticks that arrive while a frame is still being
+  * 		rendered are merged into the next frame, see LED_Tile_FX_Set_Policy.
+  *
+  * @param  LED_Tile *tile
+  * @retval None
+  */
+void LED_Tile_FX_Update(LED_Tile *tile){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();			//count and stamp of the same tick
+	uint32_t ticks = tile->fx.ticks;
+	uint32_t release = tile->fx.tick_stamp;
+	__set_PRIMASK(primask);
+	if(tile->fx.en == 0 || ticks == tile->fx.frames){
+		return;
+	}
+	uint32_t start = DWT->CYCCNT;
+	uint32_t period_us = tile->update_timer.period_us;
+	uint32_t late = ticks - tile->fx.frames - 1;
+	uint32_t dt_us = (tile->fx.policy == TILE_FX_DROP) ? (late + 1) * period_us : tile->fx.dt_us;
+	tile->fx.dropped += late;
+	tile->fx.frames = ticks;
+	tile->fx.frame_start = start;
+
+	LED_Tile_Begin(tile);		//register writes made while rendering go out with the commit
+	const LED_Tile_Effect *next = tile->fx.pending;
+	if(next != NULL){
+		tile->fx.pending = NULL;
+		if(tile->fx.active != NULL && tile->fx.active->teardown != NULL){
+			tile->fx.active->teardown(tile, tile->fx.active->state);
+		}
+		tile->fx.active = next;
+	}
+	if(tile->fx.active != NULL && tile->fx.active->render != NULL){
+		tile->fx.active->render(tile, tile->fx.active->state, dt_us);
+	}
+	LED_Tile_Commit(tile);
+	LED_Tile_Diag_Step(tile);
+
+	tile->fx.frame_end = DWT->CYCCNT;
+	uint32_t cycles = tile->fx.frame_end - start;
+	if(cycles > tile->fx.render_cycles){
+		tile->fx.render_cycles = cycles;
+	}
+	if(tile->fx.frame_end - release > period_us * (SystemCoreClock / 1000000)){
+		tile->fx.missed++;
+	}
+	tile->fx.load_cycles += (int32_t)(tile->fx.frame_end - release - tile->fx.load_cycles) / 8;
+	if(tile->fx.adapt){
+		_LED_Tile_FX_Adapt(tile);
+	}
+}
@@ -0,0 +1,43 @@
+/*
+ * led_tile_fx.h
+ *
+ *  Created on: Jun 25, 2021
+ *      Author: THollis
+ */
+
+#ifndef INC_LED_TILE_LED_TILE_FX_H_
+#define INC_LED_TILE_LED_TILE_FX_H_
+
+#include "main.h"
+#include "led_tile.h"
+
+#define TILE_FX_MAX		8		//effects in the registry
+#define TILE_FX_PRIO	15		//PendSV priority, lowest, the render task runs there
+#define TILE_FX_HEADROOM	4		//adaptive rate keeps the period 1 + 1/n above the average frame
+
+typedef enum {
+	TILE_FX_DROP,			//late ticks are skipped, dt is the real time since the last frame
+	TILE_FX_STRETCH			//every frame advances by the nominal dt, effects slow down under load
+} LED_Tile_FX_Policy;
+
+//An effect draws into the LED_Tile framebuffer (LED_Tile_Draw_*), the pipeline commits it.
+//The state is statically allocated by the effect and only touched through these callbacks.
+typedef struct LED_Tile_Effect {
+	const char *name;
+	void *state;
+	void (*init)(LED_Tile *tile, void *state, uint32_t dt_us);		//thread mode, before the first render
+	void (*render)(LED_Tile *tile, void *state, uint32_t dt_us);	//PendSV, once per frame, dt_us may vary
+	void (*teardown)(LED_Tile *tile, void *state);					//PendSV or thread mode, after the last render
+} LED_Tile_Effect;
+
+int8_t LED_Tile_FX_Register(const LED_Tile_Effect *fx);
+uint8_t LED_Tile_FX_Count(void);
+const LED_Tile_Effect *LED_Tile_FX_Get(uint8_t id);
+uint8_t LED_Tile_FX_Select(LED_Tile *tile, uint8_t id);
+void LED_Tile_FX_Start(LED_Tile *tile, float freq);
+void LED_Tile_FX_Stop(LED_Tile *tile);
+void LED_Tile_FX_Set_Policy(LED_Tile *tile, LED_Tile_FX_Policy policy, uint8_t adapt);
+void LED_Tile_FX_Tick(LED_Tile *tile);
+void LED_Tile_FX_Update(LED_Tile *tile);
+
+#endif /* INC_LED_TILE_LED_TILE_FX_H_ */
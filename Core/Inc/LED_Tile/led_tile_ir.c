@@ -0,0 +1,386 @@
+/*
+ * led_tile_ir.c
+ *
+ *  Created on: Jun 25, 2021
+ *      Author: THollis
+ */
+
+#include "main.h"
+#include "led_tile_ir.h"
+
+#define TILE_IR_ONE		(1 << TILE_IR_Q)
+
+//Move the prediction by d, Q TILE_IR_Q, keeping the whole us and the fraction apart so the
+//prediction wraps with the timer
+static void _LED_Tile_IR_Advance(LED_Tile_IR_PLL *pll, int32_t d){
+	int32_t total = (int32_t)pll->frac + d;
+	pll->next += (uint32_t)(total >> TILE_IR_Q);
+	pll->frac = (uint32_t)total & (TILE_IR_ONE - 1);
+}
+
+static void _LED_Tile_IR_Latency(LED_Tile_IR_PLL *pll, int32_t latency){
+	pll->latency = latency;
+	if(latency < pll->latency_min){
+		pll->latency_min = latency;
+	}
+	if(latency > pll->latency_max){
+		pll->latency_max = latency;
+	}
+}
+
+static uint32_t _LED_Tile_IR_Sqrt(uint32_t x){
+	uint32_t r = 0;
+	for(uint32_t bit = 1UL << 30; bit; bit >>= 2){
+		if(x >= r + bit){
+			x -= r + bit;
+			r = (r >> 1) + bit;
+		}
+		else{
+			r >>= 1;
+		}
+	}
+	return r;
+}
+
+/**
+  * @brief  Reset the IR Strobe PLL
+  * @note	Forget the sync, the PLL acquires again from the next two syncs. Clears the statistics.
+  *
+  * @param  LED_Tile_IR_PLL *pll, int32_t offset_us
+  * @retval None
+  */
+void LED_Tile_IR_PLL_Reset(LED_Tile_IR_PLL *pll, int32_t offset_us){
+	pll->next = pll->frac = pll->period = 0;
+	pll->next_idx = pll->pulse_idx = 0;
+	pll->offset = offset_us;
+	pll->state = 0;
+	pll->locked = pll->lock_count = 0;
+	pll->last_sync = pll->last_fire = 0;
+	pll->last_sync_idx = pll->last_fire_idx = 0xFFFFFFFF;
+	LED_Tile_IR_PLL_Clear_Stats(pll);
+}
+
+/**
+  * @brief  Clear the IR Strobe Statistics
+  *
+  * @param  LED_Tile_IR_PLL *pll
+  * @retval None
+  */
+void LED_Tile_IR_PLL_Clear_Stats(LED_Tile_IR_PLL *pll){
+	pll->error = 0;
+	pll->jitter_max = pll->jitter_sq_us2 = 0;
+	pll->latency = 0;
+	pll->latency_min = INT32_MAX;
+	pll->latency_max = INT32_MIN;
+	pll->syncs = pll->missed = pll->glitches = pll->unlocks = 0;
+}
+
+/**
+  * @brief  Feed a Sync to the IR Strobe PLL
+  * @note	t_us is the captured time of the sync edge. The phase error against the prediction
+  * 		pulls the phase by 1 / 2^TILE_IR_KP_SHIFT and the period by 1 / 2^TILE_IR_KI_SHIFT.
+  * 		An edge more than a quarter period early is a glitch and ignored, one more than half a
+  * 		period late means syncs were missed and the prediction is stepped over them. After
+  * 		TILE_IR_MISS_MAX missing syncs the PLL acquires again.
+  *
+  * @param  LED_Tile_IR_PLL *pll, uint32_t t_us
+  * @retval uint8_t - 1 if the prediction changed and the pending pulse should be re-aimed
+  */
+uint8_t LED_Tile_IR_PLL_Sync(LED_Tile_IR_PLL *pll, uint32_t t_us){
+	if(pll->state == 0){
+		pll->last_sync = t_us;
+		pll->state = 1;
+		return 0;
+	}
+
+	if(pll->state == 1){	//Period from the first two syncs, the first pulse belongs to the third
+		if(t_us == pll->last_sync){
+			return 0;
+		}
+		pll->period = (t_us - pll->last_sync) << TILE_IR_Q;
+		pll->next = pll->last_sync = t_us;
+		pll->frac = 0;
+		pll->last_sync_idx = pll->next_idx;
+		_LED_Tile_IR_Advance(pll, pll->period);
+		pll->pulse_idx = ++pll->next_idx;
+		pll->state = 2;
+		return 1;
+	}
+
+	int32_t half = pll->period >> 1;
+	int32_t d = (int32_t)(t_us - pll->next);
+	if(d > (INT32_MAX >> TILE_IR_Q) || d < -(INT32_MAX >> TILE_IR_Q)){
+		pll->state = 0;
+		return LED_Tile_IR_PLL_Sync(pll, t_us);
+	}
+	int32_t e = d * TILE_IR_ONE - (int32_t)pll->frac;
+	if(e < -(half >> 1)){
+		pll->glitches++;
+		return 0;
+	}
+	for(uint8_t n = 0; e > half; n++){
+		if(n == TILE_IR_MISS_MAX){
+			if(pll->locked){
+				pll->unlocks++;
+			}
+			pll->locked = pll->lock_count = 0;
+			pll->state = 0;
+			return LED_Tile_IR_PLL_Sync(pll, t_us);
+		}
+		_LED_Tile_IR_Advance(pll, pll->period);
+		pll->next_idx++;
+		pll->missed++;
+		e -= pll->period;
+	}
+
+	pll->last_sync = t_us;
+	pll->last_sync_idx = pll->next_idx;
+	if(pll->last_fire_idx == pll->next_idx){	//Pulse ahead of its sync, negative offset
+		_LED_Tile_IR_Latency(pll, (int32_t)(pll->last_fire - t_us));
+	}
+
+	//Statistics, the mean square is kept in us^2 Q8 from the error in us Q4
+	uint32_t mag = (e < 0) ? -e : e;
+	uint32_t ns = ((uint64_t)mag * 1000) >> TILE_IR_Q;
+	uint32_t q4 = mag >> (TILE_IR_Q - 4);
+	uint32_t sq = (q4 > 0xFFFF) ? 0xFFFFFFFF : q4 * q4;
+	pll->error = e;
+	if(ns > pll->jitter_max){
+		pll->jitter_max = ns;
+	}
+	if(sq > pll->jitter_sq_us2){
+		pll->jitter_sq_us2 += (sq - pll->jitter_sq_us2) >> 4;
+	}
+	else{
+		pll->jitter_sq_us2 -= (pll->jitter_sq_us2 - sq) >> 4;
+	}
+	if(mag < (TILE_IR_LOCK_US << TILE_IR_Q)){
+		if(pll->lock_count < TILE_IR_LOCK_COUNT){
+			pll->lock_count++;
+		}
+		else{
+			pll->locked = 1;
+		}
+	}
+	else{
+		if(pll->locked){
+			pll->unlocks++;
+		}
+		pll->locked = pll->lock_count = 0;
+	}
+	pll->syncs++;
+
+	_LED_Tile_IR_Advance(pll, e >> TILE_IR_KP_SHIFT);
+	pll->period += e >> TILE_IR_KI_SHIFT;
+	_LED_Tile_IR_Advance(pll, pll->period);
+	pll->next_idx++;
+	return 1;
+}
+
+/**
+  * @brief  Report a Pulse to the IR Strobe PLL
+  * @note	t_us is the time the pulse was started at. Moves on to the pulse of the next sync.
+  * 		Without syncs the pulses freewheel at the last period, until TILE_IR_MISS_MAX are
+  * 		missing and the PLL stops (state 0).
+  *
+  * @param  LED_Tile_IR_PLL *pll, uint32_t t_us
+  * @retval uint32_t - start time of the next pulse, see LED_Tile_IR_PLL_Target
+  */
+uint32_t LED_Tile_IR_PLL_Fired(LED_Tile_IR_PLL *pll, uint32_t t_us){
+	pll->last_fire = t_us;
+	pll->last_fire_idx = pll->pulse_idx;
+	if(pll->last_sync_idx == pll->pulse_idx){	//Pulse after its sync
+		_LED_Tile_IR_Latency(pll, (int32_t)(t_us - pll->last_sync));
+	}
+	pll->pulse_idx++;
+
+	while((int32_t)(pll->pulse_idx - pll->next_idx) > 1){
+		_LED_Tile_IR_Advance(pll, pll->period);
+		pll->next_idx++;
+		pll->missed++;
+	}
+	if((int32_t)(pll->pulse_idx - pll->last_sync_idx) > TILE_IR_MISS_MAX){
+		if(pll->locked){
+			pll->unlocks++;
+		}
+		pll->locked = pll->lock_count = 0;
+		pll->state = 0;
+	}
+	return LED_Tile_IR_PLL_Target(pll);
+}
+
+/**
+  * @brief  Start Time of the Pending Pulse
+  *
+  * @param  LED_Tile_IR_PLL *pll
+  * @retval uint32_t - predicted time of sync pulse_idx + offset, us
+  */
+uint32_t LED_Tile_IR_PLL_Target(LED_Tile_IR_PLL *pll){
+	int32_t d = (int32_t)pll->frac + (int32_t)(pll->pulse_idx - pll->next_idx) * (int32_t)pll->period;
+	return pll->next + (uint32_t)(d >> TILE_IR_Q) + (uint32_t)pll->offset;
+}
+
+/**
+  * @brief  RMS Jitter of the Sync
+  * @note	Root of the running mean square phase error, i.e. the jitter of the sync against the
+  * 		PLL, including the capture resolution of 1 us.
+  *
+  * @param  LED_Tile_IR_PLL *pll
+  * @retval uint32_t - RMS phase error in ns
+  */
+uint32_t LED_Tile_IR_PLL_Jitter_RMS(LED_Tile_IR_PLL *pll){
+	return (_LED_Tile_IR_Sqrt(pll->jitter_sq_us2) * 1000) >> 4;
+}
+
+#if TILE_IR_SYNC
+static LED_Tile_IR_PLL ir_pll;
+
+/**
+  * @brief  Start the Camera Synchronised IR Strobe
+  * @note	The IR channel of every tile is pre-staged at full PWM with the IREF code of intensity,
+  * 		then the nOE timer is armed for pulses of width_us and the sync timer started. From
+  * 		then on nothing is written over SPI for the strobe: the sync edge is captured on CH2,
+  * 		the PLL aims CH1 at offset_us after the predicted sync and the CH1 compare pulse on
+  * 		TRGO starts the nOE pulse in hardware. Pulses start with the third sync.
+  * 		nOE gates all channels, so anything else lit on the tiles shows only in the pulses.
+  * 		The master brightness applies to the IR channel as well.
+  *
+  * @param  LED_Tile *tile, int32_t offset_us, uint16_t width_us, float intensity
+  * @retval uint8_t - 1 if started, 0 without an nOE timer or for a width of 0
+  */
+uint8_t LED_Tile_IR_Start(LED_Tile *tile, int32_t offset_us, uint16_t width_us, float intensity){
+	TIM_HandleTypeDef *htim = &TILE_IR_HTIM;
+	TIM_IC_InitTypeDef sConfigIC = {0};
+	TIM_OC_InitTypeDef sConfigOC = {0};
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+	if(tile->oe == NULL || width_us == 0){
+		return 0;
+	}
+
+	LED_Tile_Begin(tile);
+	for(uint16_t dev = 0; dev < tile->num_tiles; dev++){
+		LED_Tile_Set_LED_Intensity(tile, dev, TILE_NUM_LEDS, intensity);
+	}
+	LED_Tile_Flush(tile);
+	for(uint16_t dev = 0; dev < tile->num_tiles; dev++){
+		LED_Tile_Draw_IR(tile, dev, 255);
+	}
+	LED_Tile_Commit(tile);
+
+	HAL_NVIC_DisableIRQ(TILE_IR_IRQn);
+	LED_Tile_IR_PLL_Reset(&ir_pll, offset_us);
+	PCA9745_OE_Arm(tile->oe, width_us, TILE_IR_TRIGGER);
+
+	htim->Init.Prescaler = TILE_IR_TIM_MHZ - 1;
+	htim->Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim->Init.Period = 0xFFFFFFFF;
+	htim->Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	htim->Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+	HAL_TIM_Base_Init(htim);
+
+	sConfigIC.ICPolarity = TILE_IR_SYNC_EDGE;
+	sConfigIC.ICSelection = TIM_ICSELECTION_DIRECTTI;
+	sConfigIC.ICPrescaler = TIM_ICPSC_DIV1;
+	sConfigIC.ICFilter = 0x3;		//8 samples at the timer clock, ~100 ns
+	HAL_TIM_IC_ConfigChannel(htim, &sConfigIC, TIM_CHANNEL_2);
+
+	//CH1 only times the pulse, TRGO carries it to the nOE timer once the PLL tracks
+	sConfigOC.OCMode = TIM_OCMODE_TIMING;
+	sConfigOC.Pulse = 0;
+	HAL_TIM_OC_ConfigChannel(htim, &sConfigOC, TIM_CHANNEL_1);
+	htim->Instance->CR2 &= ~TIM_CR2_MMS;
+
+	GPIO_InitStruct.Pin = TILE_IR_SYNC_PIN;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_PULLDOWN;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+	GPIO_InitStruct.Alternate = TILE_IR_SYNC_AF;
+	HAL_GPIO_Init(TILE_IR_SYNC_PORT, &GPIO_InitStruct);
+
+	htim->Instance->SR = 0;
+	__HAL_TIM_ENABLE_IT(htim, TIM_IT_CC1 | TIM_IT_CC2);
+	HAL_NVIC_SetPriority(TILE_IR_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(TILE_IR_IRQn);
+	TIM_CCxChannelCmd(htim->Instance, TIM_CHANNEL_2, TIM_CCx_ENABLE);
+	__HAL_TIM_ENABLE(htim);
+	return 1;
+}
+
+/**
+  * @brief  Stop the Camera Synchronised IR Strobe
+  * @note	Stop the sync timer and return nOE to the dimmer at its last duty. The IR channel is
+  * 		left as staged.
+  *
+  * @param  LED_Tile *tile
+  * @retval None
+  */
+void LED_Tile_IR_Stop(LED_Tile *tile){
+	TIM_HandleTypeDef *htim = &TILE_IR_HTIM;
+
+	HAL_NVIC_DisableIRQ(TILE_IR_IRQn);
+	htim->Instance->CR2 &= ~TIM_CR2_MMS;
+	__HAL_TIM_DISABLE_IT(htim, TIM_IT_CC1 | TIM_IT_CC2);
+	TIM_CCxChannelCmd(htim->Instance, TIM_CHANNEL_2, TIM_CCx_DISABLE);
+	htim->Instance->CR1 &= ~TIM_CR1_CEN;
+	ir_pll.state = 0;
+	ir_pll.locked = 0;
+	if(tile->oe != NULL){
+		PCA9745_OE_Set_Duty(tile->oe, tile->oe->duty);
+	}
+}
+
+/**
+  * @brief  State and Statistics of the IR Strobe
+  * @note	latency is CH1 compare - sync capture. The light follows the compare by the one tick of
+  * 		the nOE timer plus the turn on of the drivers, a fixed delay.
+  *
+  * @param  None
+  * @retval LED_Tile_IR_PLL *
+  */
+LED_Tile_IR_PLL *LED_Tile_IR_Get_PLL(void){
+	return &ir_pll;
+}
+
+/**
+  * @brief  IR Strobe Sync Timer Interrupt
+  * @note	A pulse that has fired is handled before a new sync, so the sync never re-aims a pulse
+  * 		that has already gone out. A pending pulse is only moved while both its old and new
+  * 		time are at least TILE_IR_MARGIN_US away.
+  *
+  * @param  None
+  * @retval None
+  */
+void LED_Tile_IR_IRQHandler(void){
+	TIM_TypeDef *tim = TILE_IR_HTIM.Instance;
+	uint32_t sr = tim->SR;
+
+	if(sr & TIM_SR_CC1IF){	//Compares while TRGO is off sent no pulse
+		tim->SR = ~TIM_SR_CC1IF;
+		if(tim->CR2 & TIM_CR2_MMS){
+			tim->CCR1 = LED_Tile_IR_PLL_Fired(&ir_pll, tim->CCR1);
+			if(ir_pll.state != 2){
+				tim->CR2 &= ~TIM_CR2_MMS;
+			}
+		}
+	}
+	if(sr & TIM_SR_CC2IF){
+		if(sr & TIM_SR_CC2OF){
+			tim->SR = ~TIM_SR_CC2OF;
+			ir_pll.glitches++;
+		}
+		if(LED_Tile_IR_PLL_Sync(&ir_pll, tim->CCR2)){
+			uint8_t idle = !(tim->CR2 & TIM_CR2_MMS);
+			if(idle){	//No pulse pending, aim at the next sync
+				ir_pll.pulse_idx = ir_pll.next_idx;
+			}
+			uint32_t target = LED_Tile_IR_PLL_Target(&ir_pll);
+			uint32_t now = tim->CNT;
+			if((int32_t)(target - now) > TILE_IR_MARGIN_US && (idle || (int32_t)(tim->CCR1 - now) > TILE_IR_MARGIN_US)){
+				tim->CCR1 = target;
+				tim->CR2 |= TIM_TRGO_OC1;
+			}
+		}
+	}
+}
+#endif
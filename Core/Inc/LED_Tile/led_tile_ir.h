@@ -0,0 +1,61 @@
+/*
+ * led_tile_ir.h
+ *
+ *  Created on: Jun 25, 2021
+ *      Author: THollis
+ */
+
+#ifndef INC_LED_TILE_LED_TILE_IR_H_
+#define INC_LED_TILE_LED_TILE_IR_H_
+
+#include "main.h"
+#include "led_tile.h"
+
+#define TILE_IR_Q			8		//fractional bits of the PLL period and phase, 1 us = 1 << TILE_IR_Q
+#define TILE_IR_KP_SHIFT	2		//phase correction per sync, 1/4 of the phase error
+#define TILE_IR_KI_SHIFT	5		//period correction per sync, 1/32 of the phase error
+#define TILE_IR_LOCK_US		20		//phase error below which a sync counts towards lock
+#define TILE_IR_LOCK_COUNT	8		//consecutive syncs within TILE_IR_LOCK_US to report lock
+#define TILE_IR_MARGIN_US	5		//a pending pulse is only re-aimed if it is this far in the future
+#define TILE_IR_MISS_MAX	16		//missing syncs bridged before the PLL reacquires
+
+//Second order phase locked loop on sync timestamps, integer only so it runs unchanged on the host.
+//Times are free running microseconds (wrapping at 2^32), the sync period and the prediction carry
+//TILE_IR_Q fractional bits. Sync k is expected at next + (k - next_idx) * period, the pulse of
+//sync k starts offset us after that.
+typedef struct {
+	uint32_t next;			//predicted time of sync next_idx, whole us
+	uint32_t frac;			//fraction of next, Q TILE_IR_Q
+	uint32_t period;		//sync period, Q TILE_IR_Q
+	uint32_t next_idx;		//index of the sync next predicts
+	uint32_t pulse_idx;		//index of the sync the scheduled pulse belongs to
+	int32_t offset;			//pulse start relative to its sync, -period < offset < period
+	uint8_t state;			//0 - no sync, 1 - one sync seen, 2 - tracking
+	uint8_t locked;			//1 - the last TILE_IR_LOCK_COUNT syncs were within TILE_IR_LOCK_US
+	uint8_t lock_count;
+
+	uint32_t last_sync, last_sync_idx;		//last sync captured
+	uint32_t last_fire, last_fire_idx;		//last pulse started
+	int32_t error;							//phase error of the last sync, us Q TILE_IR_Q
+	uint32_t jitter_max;					//largest |error| since the statistics were cleared, ns
+	uint32_t jitter_sq_us2;					//running mean square of error, us^2 Q8 (error in us Q4), 1/16 per sync
+	int32_t latency;						//start of the last pulse - its sync, us
+	int32_t latency_min, latency_max;		//us
+	uint32_t syncs, missed, glitches, unlocks;
+} LED_Tile_IR_PLL;
+
+void LED_Tile_IR_PLL_Reset(LED_Tile_IR_PLL *pll, int32_t offset_us);
+void LED_Tile_IR_PLL_Clear_Stats(LED_Tile_IR_PLL *pll);
+uint8_t LED_Tile_IR_PLL_Sync(LED_Tile_IR_PLL *pll, uint32_t t_us);
+uint32_t LED_Tile_IR_PLL_Fired(LED_Tile_IR_PLL *pll, uint32_t t_us);
+uint32_t LED_Tile_IR_PLL_Target(LED_Tile_IR_PLL *pll);
+uint32_t LED_Tile_IR_PLL_Jitter_RMS(LED_Tile_IR_PLL *pll);
+
+#if TILE_IR_SYNC
+uint8_t LED_Tile_IR_Start(LED_Tile *tile, int32_t offset_us, uint16_t width_us, float intensity);
+void LED_Tile_IR_Stop(LED_Tile *tile);
+LED_Tile_IR_PLL *LED_Tile_IR_Get_PLL(void);
+void LED_Tile_IR_IRQHandler(void);
+#endif
+
+#endif /* INC_LED_TILE_LED_TILE_IR_H_ */
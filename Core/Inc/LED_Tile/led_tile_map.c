@@ -0,0 +1,139 @@
+/*
+ * led_tile_map.c
+ *
+ *  Created on: Jun 25, 2021
+ *      Author: THollis
+ */
+
+#include "main.h"
+#include "led_tile.h"
+#include "led_tile_map.h"
+
+static LED_Tile_Map map;
+static LED_Tile_Placement grid[TILE_MAX_TILES];
+
+static const uint8_t led_pos[TILE_NUM_LEDS][2] = TILE_MAP_LED_POS;
+
+/**
+  * @brief  Build the Pixel Map
+  * @note	Place every tile on a w x h pixel wall and precompute, for each pixel, where its red,
+  * 		green and blue values live in the framebuffer. This is the only place that knows the
+  * 		channel order of a tile (TILE_LED_CH), the LED positions on the PCB (TILE_MAP_LED_POS)
+  * 		and the rotation of each tile, so drawing a pixel is a single table lookup.
+  *
+  * @note	Pixels not covered by a tile are TILE_MAP_NONE, so irregular walls and gaps are fine.
+  * 		The framebuffer order is the chain order, so PCA9745_Set_PWMx's register reversal is
+  * 		left to LED_Tile_Commit.
+  *
+  * @param  LED_Tile *tile, const LED_Tile_Placement *layout (tile->num_tiles entries), uint16_t w, uint16_t h
+  * @retval uint8_t - 1 on success, 0 if the wall is too big, a tile does not fit or two LEDs overlap
+  */
+uint8_t LED_Tile_Map_Build(LED_Tile *tile, const LED_Tile_Placement *layout, uint16_t w, uint16_t h){
+	if((uint32_t)w * h > TILE_MAP_MAX){
+		return 0;
+	}
+	tile->map = NULL;
+	map.w = w;
+	map.h = h;
+	map.num_pixels = 0;
+	for(uint16_t i = 0; i < w * h; i++){
+		map.off[i] = TILE_MAP_NONE;
+	}
+
+	for(uint16_t dev = 0; dev < tile->num_tiles; dev++){
+		for(uint8_t led = 0; led < TILE_NUM_LEDS; led++){
+			uint16_t lx = led_pos[led][0], ly = led_pos[led][1], x, y;
+			switch(layout[dev].rot){
+			case TILE_ROT_90:
+				x = TILE_MAP_TILE_H - 1 - ly;
+				y = lx;
+				break;
+			case TILE_ROT_180:
+				x = TILE_MAP_TILE_W - 1 - lx;
+				y = TILE_MAP_TILE_H - 1 - ly;
+				break;
+			case TILE_ROT_270:
+				x = ly;
+				y = TILE_MAP_TILE_W - 1 - lx;
+				break;
+			default:
+				x = lx;
+				y = ly;
+				break;
+			}
+			x += layout[dev].x;
+			y += layout[dev].y;
+			if(x >= w || y >= h || map.off[y * w + x] != TILE_MAP_NONE){
+				return 0;
+			}
+			map.off[y * w + x] = dev * sizeof(LED_Tile_Pixels) + TILE_LED_CH(led, TILE_RED);
+			map.num_pixels++;
+		}
+	}
+	tile->map = &map;
+	return 1;
+}
+
+/**
+  * @brief  Build a Grid Pixel Map
+  * @note	Unrotated tiles placed left to right, top to bottom, cols tiles per row.
+  *
+  * @param  LED_Tile *tile, uint16_t cols
+  * @retval uint8_t - 1 on success, 0 if the wall is too big
+  */
+uint8_t LED_Tile_Map_Grid(LED_Tile *tile, uint16_t cols){
+	if(cols == 0){
+		return 0;
+	}
+	uint16_t rows = (tile->num_tiles + cols - 1) / cols;
+	for(uint16_t dev = 0; dev < tile->num_tiles; dev++){
+		grid[dev].x = (dev % cols) * TILE_MAP_TILE_W;
+		grid[dev].y = (dev / cols) * TILE_MAP_TILE_H;
+		grid[dev].rot = TILE_ROT_0;
+	}
+	return LED_Tile_Map_Build(tile, grid, cols * TILE_MAP_TILE_W, rows * TILE_MAP_TILE_H);
+}
+
+/**
+  * @brief  Pixel Index of a Coordinate
+  *
+  * @param  LED_Tile *tile, uint16_t x, uint16_t y
+  * @retval uint16_t - y * w + x, TILE_MAP_NONE if outside the map
+  */
+uint16_t LED_Tile_Map_Index(LED_Tile *tile, uint16_t x, uint16_t y){
+	if(tile->map == NULL || x >= tile->map->w || y >= tile->map->h){
+		return TILE_MAP_NONE;
+	}
+	return y * tile->map->w + x;
+}
+
+/**
+  * @brief  Draw Pixel
+  * @note	Set the RGB value of pixel i of the map in the framebuffer. Pixels without an LED
+  * 		are ignored. Nothing is sent until LED_Tile_Commit.
+  *
+  * @param  LED_Tile *tile, uint16_t i, uint8_t red, uint8_t green, uint8_t blue
+  * @retval None
+  */
+void LED_Tile_Draw_Pixel(LED_Tile *tile, uint16_t i, uint8_t red, uint8_t green, uint8_t blue){
+	uint16_t off = tile->map->off[i];
+	if(off != TILE_MAP_NONE){
+		uint8_t *ch = tile->fb[0].ch + off;
+		ch[TILE_RED] = red;
+		ch[TILE_GREEN] = green;
+		ch[TILE_BLUE] = blue;
+	}
+}
+
+/**
+  * @brief  Draw Pixel at a Coordinate
+  *
+  * @param  LED_Tile *tile, uint16_t x, uint16_t y, uint8_t red, uint8_t green, uint8_t blue
+  * @retval None
+  */
+void LED_Tile_Draw_XY(LED_Tile *tile, uint16_t x, uint16_t y, uint8_t red, uint8_t green, uint8_t blue){
+	uint16_t i = LED_Tile_Map_Index(tile, x, y);
+	if(i != TILE_MAP_NONE){
+		LED_Tile_Draw_Pixel(tile, i, red, green, blue);
+	}
+}
@@ -0,0 +1,49 @@
+/*
+ * led_tile_map.h
+ *
+ *  Created on: Jun 25, 2021
+ *      Author: THollis
+ */
+
+#ifndef INC_LED_TILE_LED_TILE_MAP_H_
+#define INC_LED_TILE_LED_TILE_MAP_H_
+
+#include "main.h"
+#include "led_tile.h"
+
+#define TILE_MAP_MAX	2048		//pixels of the wall bounding box, w * h
+#define TILE_MAP_NONE	0xFFFF		//no LED at this pixel
+
+//Footprint of one unrotated tile in pixels and the position of each RGB LED in it, edit for the PCB
+#define TILE_MAP_TILE_W	5
+#define TILE_MAP_TILE_H	1
+#define TILE_MAP_LED_POS	{ {0, 0}, {1, 0}, {2, 0}, {3, 0}, {4, 0} }
+
+typedef enum {
+	TILE_ROT_0,
+	TILE_ROT_90,		//clockwise
+	TILE_ROT_180,
+	TILE_ROT_270
+} LED_Tile_Rotation;
+
+//Where a tile sits on the wall, one entry per tile in chain order (global tile index)
+typedef struct {
+	uint16_t x, y;				//top left pixel of the tile's footprint after rotation
+	LED_Tile_Rotation rot;
+} LED_Tile_Placement;
+
+//Pixel i = y * w + x. off[i] is the framebuffer byte offset of the pixel's red channel,
+//green and blue follow: ((uint8_t *)tile->fb)[off[i] + TILE_GREEN]
+typedef struct LED_Tile_Map {
+	uint16_t w, h;
+	uint16_t num_pixels;			//LEDs placed on the map
+	uint16_t off[TILE_MAP_MAX];
+} LED_Tile_Map;
+
+uint8_t LED_Tile_Map_Build(LED_Tile *tile, const LED_Tile_Placement *layout, uint16_t w, uint16_t h);
+uint8_t LED_Tile_Map_Grid(LED_Tile *tile, uint16_t cols);
+uint16_t LED_Tile_Map_Index(LED_Tile *tile, uint16_t x, uint16_t y);
+void LED_Tile_Draw_Pixel(LED_Tile *tile, uint16_t i, uint8_t red, uint8_t green, uint8_t blue);
+void LED_Tile_Draw_XY(LED_Tile *tile, uint16_t x, uint16_t y, uint8_t red, uint8_t green, uint8_t blue);
+
+#endif /* INC_LED_TILE_LED_TILE_MAP_H_ */
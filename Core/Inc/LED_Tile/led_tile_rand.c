@@ -0,0 +1,94 @@
+/*
+ * led_tile_rand.c
+ *
+ *  Created on: Jun 25, 2021
+ *      Author: THollis
+ */
+
+#include "main.h"
+#include "led_tile_rand.h"
+
+#define LED_TILE_RAND_MUL 6364136223846793005ULL
+
+/**
+  * @brief  Seed a Generator
+  * @note	Seed the generator with a start value and a stream. The same seed and stream always
+  * 		give the same sequence, so runs can be reproduced. Give every effect its own stream.
+  *
+  * @param  LED_Tile_Rand *r, uint64_t seed, uint64_t stream
+  * @retval None
+  */
+void LED_Tile_Rand_Seed(LED_Tile_Rand *r, uint64_t seed, uint64_t stream){
+	r->state = 0;
+	r->inc = (stream << 1) | 0x01;
+	LED_Tile_Rand_Next(r);
+	r->state += seed;
+	LED_Tile_Rand_Next(r);
+}
+
+/**
+  * @brief  Next Random Value
+  * @note	PCG32 (XSH RR): one 64-bit multiply-add of the state, output permuted by a xorshift
+  * 		and a random rotate. Reentrant, all state is in r.
+  *
+  * @param  LED_Tile_Rand *r
+  * @retval uint32_t
+  */
+uint32_t LED_Tile_Rand_Next(LED_Tile_Rand *r){
+	uint64_t old = r->state;
+	r->state = old * LED_TILE_RAND_MUL + r->inc;
+	uint32_t xorshifted = ((old >> 18) ^ old) >> 27;
+	uint32_t rot = old >> 59;
+	return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+/**
+  * @brief  Random Value in Range
+  * @note	Uniform value from 0 to n - 1 without modulo bias, using a 32x32 -> 64 multiply and
+  * 		taking the high word (Lemire). The low word only needs checking against the rejection
+  * 		threshold when it is below n, which happens with probability n / 2^32, so the division
+  * 		is almost never executed.
+  *
+  * @param  LED_Tile_Rand *r, uint32_t n
+  * @retval uint32_t - 0 if n is 0
+  */
+uint32_t LED_Tile_Rand_Range(LED_Tile_Rand *r, uint32_t n){
+	uint64_t m = (uint64_t)LED_Tile_Rand_Next(r) * n;
+	uint32_t low = (uint32_t)m;
+	if(low < n){
+		uint32_t threshold = -n % n;
+		while(low < threshold){
+			m = (uint64_t)LED_Tile_Rand_Next(r) * n;
+			low = (uint32_t)m;
+		}
+	}
+	return m >> 32;
+}
+
+/**
+  * @brief  Seed from the Hardware RNG
+  * @note	Read 64 bits from the RNG peripheral, enabling its clock if needed. The RNG runs from
+  * 		the 48 MHz PLL output, which USB already requires. Blocking, call at start up. A seed
+  * 		error, clock error or timeout falls back to the SysTick and tick counters.
+  *
+  * @param  None
+  * @retval uint64_t
+  */
+uint64_t LED_Tile_Rand_Hardware_Seed(void){
+	uint64_t seed = ((uint64_t)HAL_GetTick() << 32) | SysTick->VAL;
+#ifdef RNG
+	RCC->AHB2ENR |= RCC_AHB2ENR_RNGEN;
+	(void)RCC->AHB2ENR;
+	RNG->CR |= RNG_CR_RNGEN;
+	for(uint8_t word = 0; word < 2; word++){
+		uint32_t start = HAL_GetTick();
+		while(!(RNG->SR & RNG_SR_DRDY)){
+			if((RNG->SR & (RNG_SR_SECS | RNG_SR_CECS)) || HAL_GetTick() - start > 2){
+				return seed;
+			}
+		}
+		seed = (seed << 32) ^ RNG->DR;
+	}
+#endif
+	return seed;
+}
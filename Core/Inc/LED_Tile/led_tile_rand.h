@@ -0,0 +1,25 @@
+/*
+ * led_tile_rand.h
+ *
+ *  Created on: Jun 25, 2021
+ *      Author: THollis
+ */
+
+#ifndef INC_LED_TILE_LED_TILE_RAND_H_
+#define INC_LED_TILE_LED_TILE_RAND_H_
+
+#include "main.h"
+
+//PCG32 generator, 64-bit state and a stream selector. Generators with the same seed and
+//different streams produce independent sequences.
+typedef struct {
+	uint64_t state;
+	uint64_t inc;		//(stream << 1) | 1
+} LED_Tile_Rand;
+
+void LED_Tile_Rand_Seed(LED_Tile_Rand *r, uint64_t seed, uint64_t stream);
+uint32_t LED_Tile_Rand_Next(LED_Tile_Rand *r);
+uint32_t LED_Tile_Rand_Range(LED_Tile_Rand *r, uint32_t n);
+uint64_t LED_Tile_Rand_Hardware_Seed(void);
+
+#endif /* INC_LED_TILE_LED_TILE_RAND_H_ */
@@ -0,0 +1,65 @@
+/*
+ * led_tile_sweep.c
+ *
+ *  Created on: Jun 25, 2021
+ *      Author: THollis
+ */
+
+#include "main.h"
+#include "led_tile.h"
+#include "led_tile_sweep.h"
+
+#define SWEEP_RAMP_US	(255UL * 1000000UL / SWEEP_RATE)	//length of one colour ramp
+
+static void _LED_Tile_Sweep_Init(LED_Tile *tile, void *state, uint32_t dt_us);
+static void _LED_Tile_Sweep_Render(LED_Tile *tile, void *state, uint32_t dt_us);
+static void _LED_Tile_Sweep_Teardown(LED_Tile *tile, void *state);
+
+static LED_Tile_Sweep sweep;
+
+const LED_Tile_Effect LED_Tile_FX_Sweep = {
+	.name = "sweep",
+	.state = &sweep,
+	.init = _LED_Tile_Sweep_Init,
+	.render = _LED_Tile_Sweep_Render,
+	.teardown = _LED_Tile_Sweep_Teardown,
+};
+
+/**
+  * @brief  Initialize sweep mode
+  * @note	Effect init, restart at the beginning of the red ramp.
+  *
+  * @param  LED_Tile *tile, void *state, uint32_t dt_us
+  * @retval None
+  */
+static void _LED_Tile_Sweep_Init(LED_Tile *tile, void *state, uint32_t dt_us){
+	LED_Tile_Sweep *s = state;
+	s->t_us = 0;
+}
+
+/**
+  * @brief  Update sweep mode
+  * @note	Effect render, the frame pipeline version of LED_Tile_Test_All. Ramps red, green and blue
+  * 		from 0 to 254 in turn on all LEDs of all tiles at SWEEP_RATE steps per second.
+  *
+  * @param  LED_Tile *tile, void *state, uint32_t dt_us
+  * @retval None
+  */
+static void _LED_Tile_Sweep_Render(LED_Tile *tile, void *state, uint32_t dt_us){
+	LED_Tile_Sweep *s = state;
+	s->t_us = (s->t_us + dt_us) % (3 * SWEEP_RAMP_US);
+	uint8_t ramp = s->t_us / SWEEP_RAMP_US;
+	uint8_t level = (s->t_us % SWEEP_RAMP_US) * 255 / SWEEP_RAMP_US;
+	LED_Tile_Fill(tile, (ramp == 0) ? level : 0, (ramp == 1) ? level : 0, (ramp == 2) ? level : 0);
+}
+
+/**
+  * @brief  Stop sweep mode
+  * @note	Effect teardown, clears the RGB LEDs.
+  *
+  * @param  LED_Tile *tile, void *state
+  * @retval None
+  */
+static void _LED_Tile_Sweep_Teardown(LED_Tile *tile, void *state){
+	LED_Tile_Fill(tile, 0, 0, 0);
+}
@@ -0,0 +1,23 @@
+/*
+ * led_tile_sweep.h
+ *
+ *  Created on: Jun 25, 2021
+ *      Author: THollis
+ */
+
+#ifndef INC_LED_TILE_LED_TILE_SWEEP_H_
+#define INC_LED_TILE_LED_TILE_SWEEP_H_
+
+#include "main.h"
+#include "led_tile.h"
+#include "led_tile_fx.h"
+
+#define SWEEP_RATE	255		//PWM steps per second of each colour ramp
+
+typedef struct {
+	uint32_t t_us;			//time into the red, green, blue cycle
+} LED_Tile_Sweep;
+
+extern const LED_Tile_Effect LED_Tile_FX_Sweep;
+
+#endif /* INC_LED_TILE_LED_TILE_SWEEP_H_ */
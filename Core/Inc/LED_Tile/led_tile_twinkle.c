@@ -0,0 +1,335 @@
+/*
+ * led_tile_twinkle.c
+ *
+ *  Created on: Jun 25, 2021
+ *      Author: THollis
+ */
+
+#include "main.h"
+#include "led_tile.h"
+#include "led_tile_twinkle.h"
+#include "math.h"
+
+static void _LED_Tile_Twinkle_Init(LED_Tile *tile, void *state, uint32_t dt_us);
+static void _LED_Tile_Twinkle_Render(LED_Tile *tile, void *state, uint32_t dt_us);
+static void _LED_Tile_Twinkle_Teardown(LED_Tile *tile, void *state);
+
+static LED_Tile_Twinkle twinkle = {
+	.chance = 500,
+	.num = 10,
+	.seed = TWINKLE_SEED,
+};
+
+const LED_Tile_Effect LED_Tile_FX_Twinkle = {
+	.name = "twinkle",
+	.state = &twinkle,
+	.init = _LED_Tile_Twinkle_Init,
+	.render = _LED_Tile_Twinkle_Render,
+	.teardown = _LED_Tile_Twinkle_Teardown,
+};
+
+//ln(k) in Q16, k = 1 - TWINKLE_K_MAX
+static uint32_t twinkle_ln[TWINKLE_K_MAX + 1];
+
+//x^n in Q30 by repeated squaring
+static uint32_t _LED_Tile_Pow(uint32_t x, uint32_t n){
+	uint32_t y = 1UL << TWINKLE_Q;
+	while(n > 0){
+		if(n & 0x01){
+			y = ((uint64_t)y * x) >> TWINKLE_Q;
+		}
+		x = ((uint64_t)x * x) >> TWINKLE_Q;
+		n >>= 1;
+	}
+	return y;
+}
+
+//Colour divided by the Q30 envelope peak, Q8
+static uint32_t _LED_Tile_Scale(uint8_t color, uint32_t peak){
+	uint64_t v = ((uint64_t)color << (TWINKLE_Q + 8)) / peak;
+	return (v > 0xFFFFFFFFUL) ? 0xFFFFFFFFUL : v;
+}
+
+//Q8 colour times Q30 envelope, saturated to 8 bits
+static inline uint8_t _LED_Tile_Envelope(uint32_t color, uint32_t env){
+	uint32_t v = ((uint64_t)color * env) >> (TWINKLE_Q + 8);
+	return (v > 0xFF) ? 0xFF : v;
+}
+
+//Free the twinkle at index i of the active list, moving the last entry into its place
+static void _LED_Tile_Twinkle_Remove(LED_Tile_Twinkle *s, uint16_t i){
+	uint16_t slot = s->active[i];
+	RGB_LED *tw = &s->slot[slot];
+	uint32_t pos = tw->dev * TILE_NUM_LEDS + tw->led;
+	tw->active = 0;
+	s->occupied[pos >> 5] &= ~(0x01UL << (pos & 0x1F));
+	s->free[slot >> 5] |= (0x01UL << (slot & 0x1F));
+	s->active[i] = s->active[--s->num_active];
+}
+
+/**
+  * @brief  Configure twinkle mode
+  * @note	Set the twinkle chance frequency based on psuedo-random values
+  * 		and set the maximum number of twinkles allowed at once. Takes effect the next time
+  * 		the effect is selected or started.
+  *
+  * @note	Updates only touch live twinkles and adding one is constant time, so num can go up to
+  * 		TWINKLE_NUM_MAX (larger values are clamped). It is also limited by the number of LEDs:
+  * 			0 < num <= number of tiles * 5
+  *
+  * @param  uint16_t chance, uint16_t num
+  * @retval None
+  */
+void LED_Tile_Twinkle_Config(uint16_t chance, uint16_t num){
+	twinkle.chance = chance;
+	twinkle.num = (num > TWINKLE_NUM_MAX) ? TWINKLE_NUM_MAX : num;
+}
+
+/**
+  * @brief  Seed twinkle mode
+  * @note	Set the seed of the twinkle random stream, used the next time the effect is selected or
+  * 		started. The same seed gives the same sequence of twinkles, e.g. for benchmarks. Defaults to
+  * 		TWINKLE_SEED, use LED_Tile_Rand_Hardware_Seed() for a different field on every boot.
+  *
+  * @param  uint64_t seed
+  * @retval None
+  */
+void LED_Tile_Twinkle_Seed(uint64_t seed){
+	twinkle.seed = seed;
+}
+
+/**
+  * @brief  Hardware twinkle mode
+  * @note	1 - every twinkle is handed to the gradation engine of its tile with LED_Tile_Fade_LED
+  * 		when it spawns, and costs no SPI traffic until it is released at the end. The hardware
+  * 		ramps are linear and symmetric, so the bi-exponential envelope is approximated by a ramp
+  * 		up and down of half its length each. A tile runs at most four fades with different
+  * 		profiles at once, spawns on a tile without a free group are skipped. The fades bypass the
+  * 		frame buffer, so hardware mode is meant for the twinkle effect on its own, not as a layer.
+  * 		0 - the envelope is computed and sent on every update (default).
+  * 		Takes effect the next time the effect is selected or started.
+  *
+  * @param  uint8_t en
+  * @retval None
+  */
+void LED_Tile_Twinkle_Hardware(uint8_t en){
+	twinkle.hw = en;
+}
+
+/**
+  * @brief  Initialize twinkle mode
+  * @note	Effect init. The ln table and the per update decay factor of every decay constant on the
+  * 		grid are computed here, so the renders only multiply. This also sets all twinkles to
+  * 		inactive and restarts the random stream.
+  *
+  * @param  LED_Tile *tile, void *state, uint32_t dt_us
+  * @retval None
+  */
+static void _LED_Tile_Twinkle_Init(LED_Tile *tile, void *state, uint32_t dt_us){
+	LED_Tile_Twinkle *s = state;
+	float time_step = dt_us / 1000000.0f;
+
+	if(twinkle_ln[2] == 0){
+		for(uint16_t k = 1; k <= TWINKLE_K_MAX; k++){
+			twinkle_ln[k] = (uint32_t)(logf((float)k) * 65536.0f);
+		}
+	}
+
+	s->dt_us = dt_us;
+	s->t_us = 0;
+	s->peak_gain = (uint32_t)(TWINKLE_A_DIV / time_step);
+	for(uint16_t k = 0; k <= TWINKLE_K_MAX; k++){
+		float q = expf(-(float)k / TWINKLE_A_DIV * time_step);
+		s->decay[k] = (q >= 1.0f) ? (1UL << TWINKLE_Q) : (uint32_t)(q * (1UL << TWINKLE_Q));
+	}
+	for(uint16_t i = 0; i < TWINKLE_NUM_MAX; i++){
+		s->slot[i].active = 0;
+	}
+	for(uint16_t w = 0; w < TWINKLE_NUM_MAX / 32; w++){
+		s->free[w] = 0xFFFFFFFFUL;
+	}
+	for(uint16_t w = 0; w < (TWINKLE_NUM_LEDS + 31) / 32; w++){
+		s->occupied[w] = 0;
+	}
+	s->num_active = 0;
+	s->hw_run = s->hw;
+	LED_Tile_Rand_Seed(&s->rand, s->seed, TWINKLE_STREAM);
+}
+
+/**
+  * @brief  Stop twinkle mode
+  * @note	Effect teardown. Sets all of the currently active twinkle LED's to zero.
+  *
+  * @param  LED_Tile *tile, void *state
+  * @retval None
+  */
+static void _LED_Tile_Twinkle_Teardown(LED_Tile *tile, void *state){
+	LED_Tile_Twinkle *s = state;
+	while(s->num_active > 0){
+		RGB_LED *tw = &s->slot[s->active[s->num_active - 1]];
+		if(s->hw_run){
+			LED_Tile_Fade_Release(tile, tw->dev, tw->led);
+		}
+		else{
+			LED_Tile_Draw_LED(tile, tw->dev, tw->led, 0, 0, 0);
+		}
+		_LED_Tile_Twinkle_Remove(s, s->num_active - 1);
+	}
+}
+
+/**
+  * @brief  Add a twinkle
+  * @note	Add a twinkle to the twinkle pool. This function picks a random LED and checks the occupancy
+  * 		bitmap, if there is already a twinkle at that location, then it will skip creating a twinkle.
+  * 		A free slot is taken from the highest set bit of the free bitmap (CLZ) and appended to the
+  * 		active list.
+  *
+  * @note	If there is a space for a new twinkle available, create necessary decay values, RGB values and scale.
+  * 		In order to find the scale, a unity gain is found by using the maximum value of the decay function.
+  * 		The peak time t_max = ln(a_1 / a_0) / (a_1 - a_0) comes from the ln table, and the envelope at that
+  * 		update is found by raising the decay factors to the power of the peak update, all in fixed point.
+  *
+  * @note	The decay values a_0 and a_1 are very important to determine the decay rate and shape of the twinkle.
+  * 		A couple of limitations to these two variables will determine the outcome of the decay function:
+  * 			a_1 != a_0, to guarantee exponential decay.
+  * 		The smaller the difference between a_0 and a_1, the slower the decay rate. Some decays may last up to
+  * 		30 seconds in the current configuration.
+  *
+  * @param  LED_Tile *tile, LED_Tile_Twinkle *s
+  * @retval None
+  */
+static void _LED_Tile_Twinkle_Add(LED_Tile *tile, LED_Tile_Twinkle *s){
+	if(s->num_active >= s->num || tile->num_tiles == 0){
+		return;
+	}
+
+	uint16_t dev = LED_Tile_Rand_Range(&s->rand, tile->num_tiles);
+	uint8_t led = LED_Tile_Rand_Range(&s->rand, TILE_NUM_LEDS);
+	uint32_t pos = dev * TILE_NUM_LEDS + led;
+	if(s->occupied[pos >> 5] & (0x01UL << (pos & 0x1F))){
+		return;
+	}
+
+	uint16_t w = 0;
+	while(s->free[w] == 0){
+		w++;
+	}
+	uint16_t i = w * 32 + 31 - __builtin_clz(s->free[w]);
+	RGB_LED *tw = &s->slot[i];
+	tw->dev = dev;
+	tw->led = led;
+	tw->k_0 = LED_Tile_Rand_Range(&s->rand, TWINKLE_K0_NUM) + TWINKLE_K0_MIN;
+	tw->k_1 = tw->k_0 + LED_Tile_Rand_Range(&s->rand, TWINKLE_DK_NUM) + 1;
+	tw->e_0 = 1UL << TWINKLE_Q;
+	tw->e_1 = 1UL << TWINKLE_Q;
+	tw->step = 0;
+
+	//t_max / time_step = ln(k_1 / k_0) / (k_1 - k_0) * TWINKLE_A_DIV / time_step
+	uint32_t ln_ratio = (twinkle_ln[tw->k_1] - twinkle_ln[tw->k_0]) / (tw->k_1 - tw->k_0);
+	if(s->hw_run){
+		//Peak time plus the slow decay down to one PWM step, split in a ramp up and down
+		uint32_t t_max_ms = ((uint64_t)ln_ratio * TWINKLE_A_DIV * 1000) >> 16;
+		uint32_t ramp_ms = (t_max_ms + TWINKLE_LN_255 * TWINKLE_A_DIV / tw->k_0) / 2;
+		uint8_t r = LED_Tile_Rand_Range(&s->rand, 255);
+		uint8_t g = LED_Tile_Rand_Range(&s->rand, 255);
+		uint8_t b = LED_Tile_Rand_Range(&s->rand, 255);
+		if(!LED_Tile_Fade_LED(tile, dev, led, r, g, b, ramp_ms, 0)){
+			return;
+		}
+		tw->peak = (uint64_t)(2 * ramp_ms + 1) * 1000 / s->dt_us + 1;
+	}
+	else{
+		tw->peak = ((uint64_t)ln_ratio * s->peak_gain + 0x8000) >> 16;
+		uint32_t peak = _LED_Tile_Pow(s->decay[tw->k_0], tw->peak) - _LED_Tile_Pow(s->decay[tw->k_1], tw->peak);
+		if(peak == 0){
+			return;
+		}
+		tw->r = _LED_Tile_Scale(LED_Tile_Rand_Range(&s->rand, 255), peak);
+		tw->g = _LED_Tile_Scale(LED_Tile_Rand_Range(&s->rand, 255), peak);
+		tw->b = _LED_Tile_Scale(LED_Tile_Rand_Range(&s->rand, 255), peak);
+	}
+	tw->active = 1;
+
+	s->free[w] &= ~(0x01UL << (i & 0x1F));
+	s->occupied[pos >> 5] |= (0x01UL << (pos & 0x1F));
+	s->active[s->num_active++] = i;
+}
+
+/**
+  * @brief  Update twinkle mode
+  * @note	Effect render. Iterate through the active twinkles and advance the bi-exponential
+  * 		decay by one time step. Each RGB value is determined using the following function:
+  * 			scale = scale_init * (exp(-a_0 * t) - exp(-a_1 * t));
+  * 		Where scale_init is the unity gain factor for the decay function. Both exponentials are kept
+  * 		in Q30 and multiplied by their per step decay factor, so no float or exp() is evaluated.
+  *
+  * @note	Only the packed list of live twinkles is walked. A finished twinkle is swapped with the
+  * 		last entry of the list, so the entry at the same index is visited next.
+  *
+  * @note	Create a random twinkle chance and if it is lower than the programmable twinkle chance, then
+  * 		spawn a new twinkle. Every full TWINKLE_CHANCE of chance spawns one more twinkle per update.
+  *
+  * @note	The frame's dt_us is split into whole time steps of the decay table. A longer frame
+  * 		raises the decay factors to the number of steps and runs the spawn chance once per step,
+  * 		so the twinkles keep their speed when the scheduler drops frames.
+  *
+  * @param  LED_Tile *tile, void *state, uint32_t dt_us
+  * @retval None
+  */
+static void _LED_Tile_Twinkle_Render(LED_Tile *tile, void *state, uint32_t dt_us){
+	LED_Tile_Twinkle *s = state;
+	s->t_us += dt_us;
+	uint32_t steps = s->t_us / s->dt_us;
+	s->t_us -= steps * s->dt_us;
+	if(steps == 0){
+		return;
+	}
+
+	uint16_t i = 0;
+	while(s->hw_run && i < s->num_active){
+		RGB_LED *tw = &s->slot[s->active[i]];
+		tw->step += steps;
+		if(tw->step >= tw->peak){
+			LED_Tile_Fade_Release(tile, tw->dev, tw->led);
+			_LED_Tile_Twinkle_Remove(s, i);
+		}
+		else{
+			i++;
+		}
+	}
+	while(!s->hw_run && i < s->num_active){
+		RGB_LED *tw = &s->slot[s->active[i]];
+		uint32_t q_0 = s->decay[tw->k_0], q_1 = s->decay[tw->k_1];
+		if(steps > 1){
+			q_0 = _LED_Tile_Pow(q_0, steps);
+			q_1 = _LED_Tile_Pow(q_1, steps);
+		}
+		tw->e_0 = ((uint64_t)tw->e_0 * q_0) >> TWINKLE_Q;
+		tw->e_1 = ((uint64_t)tw->e_1 * q_1) >> TWINKLE_Q;
+		tw->step += steps;
+		uint32_t env = tw->e_0 - tw->e_1;
+		uint8_t r = _LED_Tile_Envelope(tw->r, env);
+		uint8_t g = _LED_Tile_Envelope(tw->g, env);
+		uint8_t b = _LED_Tile_Envelope(tw->b, env);
+
+		//If twinkle has reached a minimum value, set twinkle to inactive
+		if(r <= 1 && g <= 1 && b <= 1 && tw->step > tw->peak){
+			LED_Tile_Draw_LED(tile, tw->dev, tw->led, 0, 0, 0);
+			_LED_Tile_Twinkle_Remove(s, i);
+		}
+		else{
+			LED_Tile_Draw_LED(tile, tw->dev, tw->led, r, g, b);
+			i++;
+		}
+	}
+
+	//If random value is less than programmable chance, spawn a twinkle
+	while(steps-- > 0){
+		for(uint16_t n = s->chance / TWINKLE_CHANCE; n > 0; n--){
+			_LED_Tile_Twinkle_Add(tile, s);
+		}
+		if(LED_Tile_Rand_Range(&s->rand, TWINKLE_CHANCE) < s->chance % TWINKLE_CHANCE){
+			_LED_Tile_Twinkle_Add(tile, s);
+		}
+	}
+}
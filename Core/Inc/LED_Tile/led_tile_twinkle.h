@@ -0,0 +1,72 @@
+/*
+ * led_tile_twinkle.h
+ *
+ *  Created on: Jun 25, 2021
+ *      Author: THollis
+ */
+
+#ifndef INC_LED_TILE_LED_TILE_TWINKLE_H_
+#define INC_LED_TILE_LED_TILE_TWINKLE_H_
+
+#include "main.h"
+#include "led_tile.h"
+#include "led_tile_fx.h"
+#include "led_tile_rand.h"
+
+#define TWINKLE_NUM_MAX 	256		//concurrent twinkles, multiple of 32
+#define TWINKLE_CHANCE 		10000
+#define TWINKLE_NUM_LEDS	(TILE_MAX_TILES * TILE_NUM_LEDS)
+
+//Decay constants are drawn from a grid in steps of 1 / TWINKLE_A_DIV:
+//	a_0 = (TWINKLE_K0_MIN + rand() % TWINKLE_K0_NUM) / TWINKLE_A_DIV
+//	a_1 = a_0 + (1 + rand() % TWINKLE_DK_NUM) / TWINKLE_A_DIV
+#define TWINKLE_A_DIV		20
+#define TWINKLE_K0_MIN		5
+#define TWINKLE_K0_NUM		95
+#define TWINKLE_DK_NUM		99
+#define TWINKLE_K_MAX		(TWINKLE_K0_MIN + TWINKLE_K0_NUM - 1 + TWINKLE_DK_NUM)
+#define TWINKLE_Q			30		//envelope fixed point, 1.0 = 1 << TWINKLE_Q
+#define TWINKLE_SEED		0x853C49E6748FEA9BULL	//default seed, see LED_Tile_Twinkle_Seed
+#define TWINKLE_STREAM		1						//LED_Tile_Rand stream of the twinkle effect
+#define TWINKLE_LN_255		5541					//ln(255) * 1000, decay from the peak to one PWM step
+
+typedef struct {
+	uint32_t r, g, b;		//colour divided by the envelope peak, Q8
+	uint32_t e_0, e_1;		//exp(-a_0 * t), exp(-a_1 * t) in Q30
+	uint32_t step;			//updates since the twinkle was added
+	uint32_t peak;			//update at which e_0 - e_1 peaks, hardware fade: update at which it is over
+	uint8_t k_0, k_1;		//a_0, a_1 in 1 / TWINKLE_A_DIV
+	uint8_t active;
+	uint16_t dev;
+	uint8_t led;
+} RGB_LED;
+
+typedef struct {
+	uint16_t chance;	// x / TWINKLE_CHANCE chance to spawn a twinkle per update, above TWINKLE_CHANCE spawns several
+	uint16_t num;		// maximum concurrent twinkles
+	uint64_t seed;
+	LED_Tile_Rand rand;
+	uint8_t hw;			//1 - fade in the tiles' gradation engine, see LED_Tile_Twinkle_Hardware
+	uint8_t hw_run;		//hw as of the last init
+
+	//Time step
+	uint32_t dt_us;						//time_step the tables are built for
+	uint32_t t_us;						//time rendered but not yet stepped, below dt_us
+	uint32_t decay[TWINKLE_K_MAX + 1];	//exp(-k / TWINKLE_A_DIV * time_step) in Q30
+	uint32_t peak_gain;					//TWINKLE_A_DIV / time_step, converts t_max to updates
+
+	//Pool
+	RGB_LED slot[TWINKLE_NUM_MAX];
+	uint16_t active[TWINKLE_NUM_MAX];				//slots in use, packed, num_active entries
+	uint16_t num_active;
+	uint32_t free[TWINKLE_NUM_MAX / 32];			//1 - slot is free
+	uint32_t occupied[(TWINKLE_NUM_LEDS + 31) / 32];	//1 - LED dev * TILE_NUM_LEDS + led has a twinkle
+} LED_Tile_Twinkle;
+
+extern const LED_Tile_Effect LED_Tile_FX_Twinkle;
+
+void LED_Tile_Twinkle_Config(uint16_t chance, uint16_t num);
+void LED_Tile_Twinkle_Seed(uint64_t seed);
+void LED_Tile_Twinkle_Hardware(uint8_t en);
+
+#endif /* INC_LED_TILE_LED_TILE_TWINKLE_H_ */
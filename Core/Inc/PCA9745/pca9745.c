@@ -10,6 +10,102 @@
 #include "pca9745_instr.h"
 #include "pca9745_io.h"
 
+static uint8_t _PCA9745_Shadow_Is(uint8_t *bits, uint16_t reg){
+	return (bits[reg >> 3] >> (reg & 0x07)) & 0x01;
+}
+
+static void _PCA9745_Shadow_Mark(uint8_t *bits, uint16_t reg, uint8_t state){
+	if(state){
+		bits[reg >> 3] |= (0x01 << (reg & 0x07));
+	}
+	else{
+		bits[reg >> 3] &= ~(0x01 << (reg & 0x07));
+	}
+}
+
+//The device now holds data in reg, nothing is staged for it
+static void _PCA9745_Shadow_Sent(PCA9745_Shadow *s, uint8_t reg, uint8_t data){
+	s->reg[reg] = s->sent[reg] = data;
+	_PCA9745_Shadow_Mark(s->dirty, reg, 0);
+	_PCA9745_Shadow_Mark(s->valid, reg, 1);
+}
+
+//PWMALL/IREFALL set PWM0-15/IREF0-15 of the device, nothing is tracked for other registers past the shadow
+static void _PCA9745_Shadow_Sent_All(PCA9745_Shadow *s, uint8_t all_reg, uint8_t data){
+	uint8_t first_reg = (all_reg == PWMALL) ? PWM0 : IREF0;
+	if(all_reg != PWMALL && all_reg != IREFALL){
+		return;
+	}
+	for(uint8_t reg = first_reg; reg < first_reg + 16; reg++){
+		_PCA9745_Shadow_Sent(s, reg, data);
+	}
+}
+
+static uint8_t _PCA9745_IREF_Code(PCA9745 *p, float current){
+	return (uint8_t)((4 * p->r_ext * current) / 900);
+}
+
+static uint8_t _PCA9745_Broadcast_Needed(PCA9745 *p, uint16_t dev, uint8_t first_reg, uint8_t data){
+	PCA9745_Shadow *s = &p->shadow[dev];
+	for(uint8_t reg = first_reg; reg < first_reg + 16; reg++){
+		if(!_PCA9745_Shadow_Is(s->valid, reg) || _PCA9745_Shadow_Is(s->dirty, reg) || s->reg[reg] != data){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static uint8_t _PCA9745_Broadcast_Dev(PCA9745 *p, uint16_t dev, uint8_t all_reg, uint8_t first_reg, uint8_t data){
+	if(!_PCA9745_Broadcast_Needed(p, dev, first_reg, data)){
+		return 0;
+	}
+	p->instr_buffer[dev] = all_reg;
+	p->data_buffer[dev] = data;
+	for(uint8_t reg = first_reg; reg < first_reg + 16; reg++){
+		_PCA9745_Shadow_Sent(&p->shadow[dev], reg, data);
+	}
+	return 1;
+}
+
+static void _PCA9745_Broadcast(PCA9745 *p, uint16_t dev, uint8_t all_reg, uint8_t first_reg, uint8_t data){
+	uint8_t needed = 0;
+	for(uint16_t i = 0; i < p->num_dev; i++){
+		p->instr_buffer[i] = 0xFF;
+		p->data_buffer[i] = 0xFF;
+		if(dev == PCA9745_ALL_DEVICES || dev == i){
+			needed |= _PCA9745_Broadcast_Dev(p, i, all_reg, first_reg, data);
+		}
+	}
+	if(needed){
+		_PCA9745_Write(p, p->instr_buffer, p->data_buffer);
+	}
+}
+
+static void _PCA9745_Write_Chain(PCA9745 *p, uint16_t dev, uint8_t reg, uint8_t data){
+	uint8_t needed = 0;
+	for(uint16_t i = 0; i < p->num_dev; i++){
+		p->instr_buffer[i] = 0xFF;
+		p->data_buffer[i] = 0xFF;
+		PCA9745_Shadow *s = &p->shadow[i];
+		if((dev == PCA9745_ALL_DEVICES || dev == i) &&
+				(!_PCA9745_Shadow_Is(s->valid, reg) || _PCA9745_Shadow_Is(s->dirty, reg) || s->reg[reg] != data)){
+			p->instr_buffer[i] = reg;
+			p->data_buffer[i] = data;
+			_PCA9745_Shadow_Sent(s, reg, data);
+			needed = 1;
+		}
+	}
+	if(needed){
+		_PCA9745_Write(p, p->instr_buffer, p->data_buffer);
+	}
+}
+
+static void _PCA9745_Decode_EFLAG(uint8_t flags, PCA9745_Error_TypeDef *e){
+	for(uint8_t j = 0; j < 4; j++){
+		e[j] = (flags >> (j * 2)) & 0x03;
+	}
+}
+
 /**
   * @brief  Set PWM of Channel x
   * @note	The selected channel is set to a specific current value in mA (current).
@@ -20,8 +116,7 @@
   * @retval None
   */
 void PCA9745_Set_PWMx(PCA9745 *p, uint16_t dev, uint8_t channel, uint8_t data){
-	_PCA9745_Format_Data(p, dev, PWM15 - channel, data);
-	_PCA9745_Write(p, p->instr_buffer, p->data_buffer);
+	PCA9745_Stage(p, dev, PWM15 - channel, data);
 }
 
 /**
@@ -35,9 +130,82 @@ void PCA9745_Set_PWMx(PCA9745 *p, uint16_t dev, uint8_t channel, uint8_t data){
   * @retval None
   */
 void PCA9745_Set_IREFx(PCA9745 *p, uint16_t dev, uint8_t channel, float current){
-	uint8_t data = (uint8_t)((4 * p->r_ext * current) / 900);
-	_PCA9745_Format_Data(p, dev, IREF15 - channel, data);
-	_PCA9745_Write(p, p->instr_buffer, p->data_buffer);
+	PCA9745_Set_IREFx_Code(p, dev, channel, _PCA9745_IREF_Code(p, current));
+}
+
+/**
+  * @brief  Set IREF Code of Channel x
+  * @note	Same as PCA9745_Set_IREFx with the register value given directly, for callers that
+  * 		already hold IREF codes (e.g. from a lookup table).
+  *
+  * @param  PCA9745 *p, uint16_t dev, uint8_t channel, uint8_t code
+  * @retval None
+  */
+void PCA9745_Set_IREFx_Code(PCA9745 *p, uint16_t dev, uint8_t channel, uint8_t code){
+	PCA9745_Stage(p, dev, IREF15 - channel, code);
+}
+
+/**
+  * @brief  Set PWM of All Channels
+  * @note	Writes the PWMALL broadcast register, setting PWM0 - PWM15 of a device in one write.
+  * 		With dev = PCA9745_ALL_DEVICES every device in the chain is set in a single frame.
+  * 		Devices whose 16 PWM registers already hold the value are skipped.
+  *
+  * @param  PCA9745 *p, uint16_t dev, uint8_t data
+  * @retval None
+  */
+void PCA9745_Set_PWMALL(PCA9745 *p, uint16_t dev, uint8_t data){
+	_PCA9745_Broadcast(p, dev, PWMALL, PWM0, data);
+}
+
+/**
+  * @brief  Set PWM of All Channels on Several Devices
+  * @note	Writes PWMALL to each listed device, each with its own value, in a single chain frame.
+  * 		Devices whose PWM0 - PWM15 already hold their value are skipped. The listed devices
+  * 		must be distinct.
+  *
+  * @param  PCA9745 *p, const uint16_t *dev, const uint8_t *data, uint16_t n
+  * @retval uint8_t - 1 if a frame was sent
+  */
+uint8_t PCA9745_Set_PWMALL_Multi(PCA9745 *p, const uint16_t *dev, const uint8_t *data, uint16_t n){
+	uint8_t needed = 0;
+	for(uint16_t i = 0; i < p->num_dev; i++){
+		p->instr_buffer[i] = 0xFF;
+		p->data_buffer[i] = 0xFF;
+	}
+	for(uint16_t k = 0; k < n; k++){
+		if(dev[k] < p->num_dev){
+			needed |= _PCA9745_Broadcast_Dev(p, dev[k], PWMALL, PWM0, data[k]);
+		}
+	}
+	if(needed){
+		_PCA9745_Write(p, p->instr_buffer, p->data_buffer);
+	}
+	return needed;
+}
+
+/**
+  * @brief  Set Io_LED of All Channels
+  * @note	Writes the IREFALL broadcast register, setting IREF0 - IREF15 of a device in one write.
+  * 		With dev = PCA9745_ALL_DEVICES every device in the chain is set in a single frame.
+  * 		See PCA9745_Set_IREFx for the current to register conversion.
+  *
+  * @param  PCA9745 *p, uint16_t dev, float current
+  * @retval None
+  */
+void PCA9745_Set_IREFALL(PCA9745 *p, uint16_t dev, float current){
+	PCA9745_Set_IREFALL_Code(p, dev, _PCA9745_IREF_Code(p, current));
+}
+
+/**
+  * @brief  Set IREF Code of All Channels
+  * @note	Same as PCA9745_Set_IREFALL with the register value given directly.
+  *
+  * @param  PCA9745 *p, uint16_t dev, uint8_t code
+  * @retval None
+  */
+void PCA9745_Set_IREFALL_Code(PCA9745 *p, uint16_t dev, uint8_t code){
+	_PCA9745_Broadcast(p, dev, IREFALL, IREF0, code);
 }
 
 /**
@@ -50,8 +218,7 @@ void PCA9745_Set_IREFx(PCA9745 *p, uint16_t dev, uint8_t channel, float current)
   */
 void PCA9745_Set_Sleep(PCA9745 *p, uint16_t dev, uint8_t state){
 	uint8_t data = 0x00 | (state << 4);
-	_PCA9745_Format_Data(p, dev, MODE1, data);
-	_PCA9745_Write(p, p->instr_buffer, p->data_buffer);
+	PCA9745_Stage(p, dev, MODE1, data);
 }
 
 /**
@@ -62,58 +229,348 @@ void PCA9745_Set_Sleep(PCA9745 *p, uint16_t dev, uint8_t state){
   * 	   *10 - LED driver individual brightness can be controlled through its PWMx or PWMALL register
   * 		11 - LED driver individual brightness and group dimming/blinking can be controlled through
   * 			its PWM and GRPPWM registers
-  * 		NOTE: This will not work unless MISO is enabled in SPI
+  * 		The other channels of the LEDOUTx register are taken from the shadow register file. The
+  * 		register is only read back from the device if it has never been written.
+  * 		NOTE: The read back will not work unless MISO is enabled in SPI
   * @param  PCA9745 *p, uint16_t dev, uint8_t channel, uint8_t state
   * @retval None
   */
 void PCA9745_Set_LEDOUTx(PCA9745 *p, uint16_t dev, uint8_t channel, uint8_t state){
 	uint8_t instruction = LEDOUT0 + channel / 4;
-	_PCA9745_Read(p, instruction);
-	uint8_t reg = p->rx_buffer[dev];
-	uint8_t data = (state << ((channel % 4) * 2));
-	_PCA9745_Format_Data(p, dev, instruction, (reg & ~data) | data);
-	_PCA9745_Write(p, p->instr_buffer, p->data_buffer);
+	uint8_t shift = (channel % 4) * 2;
+	uint8_t reg;
+	if(_PCA9745_Shadow_Is(p->shadow[dev].valid, instruction) || _PCA9745_Shadow_Is(p->shadow[dev].dirty, instruction)){
+		reg = p->shadow[dev].reg[instruction];
+	}
+	else{
+		_PCA9745_Read(p, instruction);
+		reg = p->rx_buffer[dev];
+	}
+	PCA9745_Stage(p, dev, instruction, (reg & ~(0x03 << shift)) | ((state & 0x03) << shift));
+}
+
+/**
+  * @brief  Set the LED driver mode of All Channels
+  * @note	Set LEDOUT0 - LEDOUT3 of a device to the same state on every channel, see
+  * 		PCA9745_Set_LEDOUTx for the states. With dev = PCA9745_ALL_DEVICES every device in the
+  * 		chain is set, one frame per LEDOUTx register. Devices already in the state are skipped.
+  *
+  * @param  PCA9745 *p, uint16_t dev, uint8_t state
+  * @retval None
+  */
+void PCA9745_Set_LEDOUT_All(PCA9745 *p, uint16_t dev, uint8_t state){
+	uint8_t data = (state & 0x03) * 0x55;
+	for(uint8_t reg = LEDOUT0; reg <= LEDOUT3; reg++){
+		_PCA9745_Write_Chain(p, dev, reg, data);
+	}
+}
+
+/**
+  * @brief  Set Group Dimming
+  * @note	Dim every channel in LEDOUT state 11 with the GRPPWM duty cycle (0 - off, 255 - full),
+  * 		on top of its own PWMx value. Clears DMBLNK in MODE2 if the device was blinking.
+  * 		With dev = PCA9745_ALL_DEVICES every device in the chain is set in a single frame per
+  * 		register, and registers already holding the value are skipped, so a change of duty
+  * 		alone costs one frame.
+  *
+  * @param  PCA9745 *p, uint16_t dev, uint8_t duty
+  * @retval None
+  */
+void PCA9745_Set_Group_Dim(PCA9745 *p, uint16_t dev, uint8_t duty){
+	_PCA9745_Write_Chain(p, dev, MODE2, PCA9745_MODE2_DEFAULT);
+	_PCA9745_Write_Chain(p, dev, GRPPWM, duty);
+}
+
+/**
+  * @brief  Set Group Blinking
+  * @note	Blink every channel in LEDOUT state 11. The blink period is (freq + 1) / 15.26 s
+  * 		(66 ms - 16.8 s) and the on time is duty / 256 of the period. Sets DMBLNK in MODE2.
+  * 		Same chain handling as PCA9745_Set_Group_Dim.
+  *
+  * @param  PCA9745 *p, uint16_t dev, uint8_t freq, uint8_t duty
+  * @retval None
+  */
+void PCA9745_Set_Group_Blink(PCA9745 *p, uint16_t dev, uint8_t freq, uint8_t duty){
+	_PCA9745_Write_Chain(p, dev, GRPFREQ, freq);
+	_PCA9745_Write_Chain(p, dev, GRPPWM, duty);
+	_PCA9745_Write_Chain(p, dev, MODE2, PCA9745_MODE2_DEFAULT | PCA9745_MODE2_DMBLNK);
 }
 
 /**
   * @brief  Check if the Temperature is OK
-  * @note	Check for the TEMPOK bit is flagged in MODE2 register on a given device.
+  * @note	Check the OVERTEMP bit in MODE2 register on a given device.
   * 		NOTE: This will not work unless MISO is enabled in SPI
   * @param  PCA9745 *p, uint16_t dev
-  * @retval None
+  * @retval uint8_t - 1 if the temperature is OK, 0 on over temperature
   */
 uint8_t PCA9745_Check_Temperature(PCA9745 *p, uint16_t dev){
 	_PCA9745_Read(p, MODE2);
 	uint8_t reg = p->rx_buffer[dev];
-	return ~(reg & (0x01 << 7));
+	return (reg & (0x01 << 7)) ? 0 : 1;
 }
 
 /**
   * @brief  Check for LED Driver Errors
-  * @note	Check for LED driver errors on a given device. If the error bit is flagged,
-  * 		check on subsequent EFLAGx registers for that error. Then store the error
-  * 		information in an PAC9745_Error_TypeDef array, e.
+  * @note	Check for LED driver errors on a given device. The EFLAG0 - EFLAG3 registers are read
+  * 		with one pipelined read (5 frames) and decoded into an PCA9745_Error_TypeDef array, e,
+  * 		of 16 entries, one per channel.
   * 		NOTE: This will not work unless MISO is enabled in SPI
   * @param  PCA9745 *p, uint16_t dev, PCA9745_Error_TypeDef *e
   * @retval None
   */
 void PCA9745_Check_Errors(PCA9745 *p, uint16_t dev, PCA9745_Error_TypeDef *e){
-	_PCA9745_Read(p, MODE2);
-	uint8_t reg = p->rx_buffer[dev];
-	uint8_t is_error = (reg & 0x01 << 6) >> 6;
-	if (is_error){
-		uint8_t flags[4 * p->num_dev];
-		for(uint8_t i = 0; i < 4 * p->num_dev; i++){
-			_PCA9745_Read(p, EFLAG0 + i);
-			flags[i] = p->rx_buffer[dev];
-			for(uint8_t j = 0; j < 4; j++){
-				e[i * 4 + j] = (flags[i] & (0x03 << j)) >> j;
+	for(uint8_t k = 0; k <= 4; k++){
+		_PCA9745_Read_Frame(p, (k < 4) ? EFLAG0 + k : 0xFF);
+		if(k > 0){
+			_PCA9745_Decode_EFLAG(p->rx_buffer[dev], &e[(k - 1) * 4]);
+		}
+	}
+}
+
+/**
+  * @brief  Check for LED Driver Errors on All Devices
+  * @note	Same as PCA9745_Check_Errors for the whole chain in the same 5 frames. e holds
+  * 		16 entries per device, e[dev * 16 + channel].
+  * 		NOTE: This will not work unless MISO is enabled in SPI
+  * @param  PCA9745 *p, PCA9745_Error_TypeDef *e
+  * @retval None
+  */
+void PCA9745_Check_Errors_All(PCA9745 *p, PCA9745_Error_TypeDef *e){
+	for(uint8_t k = 0; k <= 4; k++){
+		_PCA9745_Read_Frame(p, (k < 4) ? EFLAG0 + k : 0xFF);
+		if(k > 0){
+			for(uint16_t dev = 0; dev < p->num_dev; dev++){
+				_PCA9745_Decode_EFLAG(p->rx_buffer[dev], &e[dev * 16 + (k - 1) * 4]);
 			}
 		}
 	}
-	else{
-		for(uint8_t i = 0; i < 16 * p->num_dev; i++){
-			e[i] = NO_ERROR;
+}
+
+/**
+  * @brief  Read Registers
+  * @note	Pipelined read of n registers from every device, n + 1 frames in total.
+  * 		out is a [register][device] matrix of n * num_dev bytes.
+  * 		NOTE: This will not work unless MISO is enabled in SPI
+  * @param  PCA9745 *p, const uint8_t *regs, uint8_t n, uint8_t *out
+  * @retval None
+  */
+void PCA9745_Read_Registers(PCA9745 *p, const uint8_t *regs, uint8_t n, uint8_t *out){
+	_PCA9745_Read_Multi(p, regs, n, out);
+}
+
+/**
+  * @brief  Stage a Register Write
+  * @note	Updates the shadow copy of a register. If the value matches what was last sent to the
+  * 		device nothing is queued, and a change staged earlier is dropped. Otherwise the
+  * 		register is marked dirty and, unless deferred mode is enabled, sent immediately.
+  * 		Staging the value already staged keeps it dirty.
+  *
+  * @note	Registers outside the shadow (PWMALL, IREFALL) are always written through, and the
+  * 		PWM0-15/IREF0-15 shadow of the device takes the broadcast value, dropping anything
+  * 		staged for them.
+  *
+  * @param  PCA9745 *p, uint16_t dev, uint8_t reg, uint8_t data
+  * @retval None
+  */
+void PCA9745_Stage(PCA9745 *p, uint16_t dev, uint8_t reg, uint8_t data){
+	if(reg >= PCA9745_SHADOW_SIZE){
+		_PCA9745_Format_Data(p, dev, reg, data);
+		_PCA9745_Write(p, p->instr_buffer, p->data_buffer);
+		_PCA9745_Shadow_Sent_All(&p->shadow[dev], reg, data);
+		return;
+	}
+
+	PCA9745_Shadow *s = &p->shadow[dev];
+	s->reg[reg] = data;
+	if(_PCA9745_Shadow_Is(s->valid, reg) && s->sent[reg] == data){
+		_PCA9745_Shadow_Mark(s->dirty, reg, 0);		//Back to the device value, a staged change was reverted
+		return;
+	}
+	_PCA9745_Shadow_Mark(s->dirty, reg, 1);
+
+	if(p->deferred == 0){
+		_PCA9745_Format_Data(p, dev, reg, data);
+		_PCA9745_Write(p, p->instr_buffer, p->data_buffer);
+		_PCA9745_Shadow_Sent(s, reg, data);
+	}
+}
+
+/**
+  * @brief  Flush Staged Register Writes
+  * @note	Sends every dirty shadow register on every device, then marks them clean.
+  * 		Each chain frame carries the lowest dirty register of every device that still has
+  * 		one, so the number of frames is the largest dirty count on any single device rather
+  * 		than the total number of dirty registers.
+  *
+  * @param  PCA9745 *p
+  * @retval uint16_t - number of chain frames sent
+  */
+uint16_t PCA9745_Flush(PCA9745 *p){
+	uint16_t frames = 0;
+	while(PCA9745_Flush_Step(p)){
+		frames++;
+	}
+	return frames;
+}
+
+/**
+  * @brief  Flush One Frame of Staged Register Writes
+  * @note	Sends a single chain frame of PCA9745_Flush. With DMA enabled this returns as soon as
+  * 		the frame is started, so several chains can be flushed concurrently by stepping
+  * 		each of them in turn.
+  *
+  * @param  PCA9745 *p
+  * @retval uint8_t - 1 if a frame was sent, 0 if nothing was dirty
+  */
+uint8_t PCA9745_Flush_Step(PCA9745 *p){
+	uint8_t pending = 0;
+	for(uint16_t dev = 0; dev < p->num_dev; dev++){
+		PCA9745_Shadow *s = &p->shadow[dev];
+		p->instr_buffer[dev] = 0xFF;
+		p->data_buffer[dev] = 0xFF;
+		for(uint8_t j = 0; j < PCA9745_SHADOW_SIZE / 8; j++){
+			if(s->dirty[j] != 0x00){
+				uint8_t reg = j * 8 + __builtin_ctz(s->dirty[j]);
+				p->instr_buffer[dev] = reg;
+				p->data_buffer[dev] = s->reg[reg];
+				_PCA9745_Shadow_Sent(s, reg, s->reg[reg]);
+				pending = 1;
+				break;
+			}
+		}
+	}
+	if(pending){
+		_PCA9745_Write(p, p->instr_buffer, p->data_buffer);
+	}
+	return pending;
+}
+
+/**
+  * @brief  Write Multiple Registers
+  * @note	Schedules a list of register writes into as few chain frames as possible. Every frame
+  * 		carries at most one write per device; devices without a write in a frame get the
+  * 		no-op. Writes to the same device go out in list order, writes to different devices
+  * 		share frames. Updating one register on each of N devices therefore costs one frame.
+  *
+  * @note	Lists are scheduled in chunks of PCA9745_MULTI_CHUNK writes. The shadow register file
+  * 		is updated with the values written, PWMALL/IREFALL update PWM0-15/IREF0-15. Writes to
+  * 		a device past the end of the chain are dropped.
+  *
+  * @param  PCA9745 *p, const PCA9745_Reg_Write *writes, uint16_t n
+  * @retval uint16_t - number of chain frames sent
+  */
+uint16_t PCA9745_Write_Multi(PCA9745 *p, const PCA9745_Reg_Write *writes, uint16_t n){
+	uint8_t sent[PCA9745_MULTI_CHUNK / 8];
+	uint8_t taken[PCA9745_MAX_DEV / 8];		//devices with a write in the frame being built
+	uint16_t frames = 0;
+	for(uint16_t base = 0; base < n; base += PCA9745_MULTI_CHUNK){
+		uint16_t len = (n - base < PCA9745_MULTI_CHUNK) ? n - base : PCA9745_MULTI_CHUNK;
+		uint16_t remaining = len;
+		for(uint8_t j = 0; j < sizeof(sent); j++){
+			sent[j] = 0x00;
 		}
+		while(remaining > 0){
+			uint8_t pending = 0;
+			for(uint16_t dev = 0; dev < p->num_dev; dev++){
+				p->instr_buffer[dev] = 0xFF;
+				p->data_buffer[dev] = 0xFF;
+			}
+			for(uint16_t j = 0; j < (p->num_dev + 7) / 8; j++){
+				taken[j] = 0x00;
+			}
+			for(uint16_t i = 0; i < len; i++){
+				const PCA9745_Reg_Write *w = &writes[base + i];
+				if(_PCA9745_Shadow_Is(sent, i)){
+					continue;
+				}
+				if(w->dev >= p->num_dev){	//Not on the chain, dropped
+					_PCA9745_Shadow_Mark(sent, i, 1);
+					remaining--;
+					continue;
+				}
+				if(_PCA9745_Shadow_Is(taken, w->dev)){
+					continue;	//This device's slot is taken in this frame
+				}
+				p->instr_buffer[w->dev] = w->reg;
+				p->data_buffer[w->dev] = w->data;
+				_PCA9745_Shadow_Mark(taken, w->dev, 1);
+				_PCA9745_Shadow_Mark(sent, i, 1);
+				pending = 1;
+				remaining--;
+				if(w->reg < PCA9745_SHADOW_SIZE){
+					_PCA9745_Shadow_Sent(&p->shadow[w->dev], w->reg, w->data);
+				}
+				else{
+					_PCA9745_Shadow_Sent_All(&p->shadow[w->dev], w->reg, w->data);
+				}
+			}
+			if(pending){
+				_PCA9745_Write(p, p->instr_buffer, p->data_buffer);
+				frames++;
+			}
+		}
+	}
+	return frames;
+}
+
+/**
+  * @brief  Set Deferred Mode
+  * @note	0 - Register writes are sent as soon as they are staged.
+  * 		1 - Register writes are only staged and go out on the next PCA9745_Flush.
+  * 		Leaving deferred mode flushes anything still staged.
+  *
+  * @param  PCA9745 *p, uint8_t state
+  * @retval None
+  */
+void PCA9745_Set_Deferred(PCA9745 *p, uint8_t state){
+	p->deferred = state;
+	if(state == 0){
+		PCA9745_Flush(p);
+	}
+}
+
+/**
+  * @brief  Invalidate Shadow Registers
+  * @note	Forget everything known about a device's registers, e.g. after a reset or power cycle,
+  * 		so the next write to each register is always sent.
+  *
+  * @param  PCA9745 *p, uint16_t dev
+  * @retval None
+  */
+void PCA9745_Invalidate(PCA9745 *p, uint16_t dev){
+	for(uint8_t j = 0; j < PCA9745_SHADOW_SIZE / 8; j++){
+		p->shadow[dev].valid[j] = 0x00;
+		p->shadow[dev].dirty[j] = 0x00;
+	}
+}
+
+/**
+  * @brief  Invalidate One Shadow Register
+  * @note	Forget the device's value of a register the device changes by itself (e.g. GRAD_CNTL,
+  * 		whose START bits clear when a gradation ends), so the next write is always sent.
+  * 		A write already staged is kept.
+  *
+  * @param  PCA9745 *p, uint16_t dev, uint8_t reg
+  * @retval None
+  */
+void PCA9745_Invalidate_Reg(PCA9745 *p, uint16_t dev, uint8_t reg){
+	if(reg < PCA9745_SHADOW_SIZE){
+		_PCA9745_Shadow_Mark(p->shadow[dev].valid, reg, 0);
+	}
+}
+
+/**
+  * @brief  Get Shadow Register
+  * @note	Copies the shadow value of a register (staged or last sent) into data.
+  *
+  * @param  PCA9745 *p, uint16_t dev, uint8_t reg, uint8_t *data
+  * @retval uint8_t - 1 if the shadow value is known, 0 if the register was never written
+  */
+uint8_t PCA9745_Get_Shadow(PCA9745 *p, uint16_t dev, uint8_t reg, uint8_t *data){
+	PCA9745_Shadow *s = &p->shadow[dev];
+	if(reg >= PCA9745_SHADOW_SIZE || !(_PCA9745_Shadow_Is(s->valid, reg) || _PCA9745_Shadow_Is(s->dirty, reg))){
+		return 0;
 	}
+	*data = s->reg[reg];
+	return 1;
 }
@@ -11,11 +11,40 @@
 #include "pca9745_io.h"
 #include "pca9745_instr.h"
 
+#define PCA9745_MULTI_CHUNK 256		//writes scheduled together by PCA9745_Write_Multi
+#define PCA9745_ALL_DEVICES 0xFFFF	//dev value addressing every device in the chain
+#define PCA9745_MODE2_DEFAULT 0x05	//MODE2 at power up, group dimming
+#define PCA9745_MODE2_DMBLNK 0x20	//MODE2 group control: 0 - dimming, 1 - blinking
+
+typedef struct {
+	uint16_t dev;
+	uint8_t reg;
+	uint8_t data;
+} PCA9745_Reg_Write;
+
 void PCA9745_Set_PWMx(PCA9745 *p, uint16_t dev, uint8_t channel, uint8_t data);
 void PCA9745_Set_IREFx(PCA9745 *p, uint16_t dev, uint8_t channel, float current);
+void PCA9745_Set_IREFx_Code(PCA9745 *p, uint16_t dev, uint8_t channel, uint8_t code);
+void PCA9745_Set_PWMALL(PCA9745 *p, uint16_t dev, uint8_t data);
+uint8_t PCA9745_Set_PWMALL_Multi(PCA9745 *p, const uint16_t *dev, const uint8_t *data, uint16_t n);
+void PCA9745_Set_IREFALL(PCA9745 *p, uint16_t dev, float current);
+void PCA9745_Set_IREFALL_Code(PCA9745 *p, uint16_t dev, uint8_t code);
 void PCA9745_Set_Sleep(PCA9745 *p, uint16_t dev, uint8_t state);
 void PCA9745_Set_LEDOUTx(PCA9745 *p, uint16_t dev, uint8_t channel, uint8_t state);
+void PCA9745_Set_LEDOUT_All(PCA9745 *p, uint16_t dev, uint8_t state);
+void PCA9745_Set_Group_Dim(PCA9745 *p, uint16_t dev, uint8_t duty);
+void PCA9745_Set_Group_Blink(PCA9745 *p, uint16_t dev, uint8_t freq, uint8_t duty);
 uint8_t PCA9745_Check_Temperature(PCA9745 *p, uint16_t dev);
 void PCA9745_Check_Errors(PCA9745 *p, uint16_t dev, PCA9745_Error_TypeDef *e);
+void PCA9745_Check_Errors_All(PCA9745 *p, PCA9745_Error_TypeDef *e);
+void PCA9745_Read_Registers(PCA9745 *p, const uint8_t *regs, uint8_t n, uint8_t *out);
+void PCA9745_Stage(PCA9745 *p, uint16_t dev, uint8_t reg, uint8_t data);
+uint16_t PCA9745_Flush(PCA9745 *p);
+uint8_t PCA9745_Flush_Step(PCA9745 *p);
+uint16_t PCA9745_Write_Multi(PCA9745 *p, const PCA9745_Reg_Write *writes, uint16_t n);
+void PCA9745_Set_Deferred(PCA9745 *p, uint8_t state);
+void PCA9745_Invalidate(PCA9745 *p, uint16_t dev);
+void PCA9745_Invalidate_Reg(PCA9745 *p, uint16_t dev, uint8_t reg);
+uint8_t PCA9745_Get_Shadow(PCA9745 *p, uint16_t dev, uint8_t reg, uint8_t *data);
 
 #endif /* INC_PCA9745_H_ */
@@ -0,0 +1,138 @@
+/*
+ * pca9745_diag.c
+ *
+ *  Created on: Jun 23, 2021
+ *      Author: THollis
+ */
+
+#include "main.h"
+#include "pca9745_diag.h"
+#include "pca9745_instr.h"
+#include "pca9745_io.h"
+
+#define _PCA9745_DIAG_NONE 0xFF
+
+static const uint8_t _PCA9745_Diag_Regs[PCA9745_DIAG_NUM_REGS] = {MODE2, EFLAG0, EFLAG1, EFLAG2, EFLAG3};
+
+/**
+  * @brief  Publish One Scanned Register
+  * @note	Decode the register returned in rx_buffer into the snapshot of every device. The
+  * 		sequence counter is odd while the snapshot is being written.
+  *
+  * @param  PCA9745_Diag *d, uint8_t k - index in _PCA9745_Diag_Regs
+  * @retval None
+  */
+static void _PCA9745_Diag_Publish(PCA9745_Diag *d, uint8_t k){
+	PCA9745 *p = d->p;
+	d->seq++;
+	__DMB();
+	for(uint16_t dev = 0; dev < p->num_dev; dev++){
+		PCA9745_Diag_Status *s = &d->status[dev];
+		uint8_t reg = p->rx_buffer[dev];
+		if(k == 0){
+			s->overtemp = (reg >> 7) & 0x01;
+			s->error = (reg >> 6) & 0x01;
+		}
+		else{
+			uint8_t shift = (k - 1) * 4;
+			uint16_t mask = 0x000F << shift;
+			uint16_t open = 0, shorted = 0;
+			for(uint8_t j = 0; j < 4; j++){
+				PCA9745_Error_TypeDef e = (reg >> (j * 2)) & 0x03;
+				open |= (e == OPEN_CIRCUIT) << (shift + j);
+				shorted |= (e == SHORT_CIRCUIT) << (shift + j);
+			}
+			s->open = (s->open & ~mask) | open;
+			s->shorted = (s->shorted & ~mask) | shorted;
+		}
+	}
+	if(k == PCA9745_DIAG_NUM_REGS - 1){
+		d->scans++;
+	}
+	__DMB();
+	d->seq++;
+}
+
+/**
+  * @brief  Initialize the Diagnostics Scanner
+  * @note	Attach the scanner to a chain and clear the snapshot. budget is the number of scan
+  * 		registers each PCA9745_Diag_Step reads, 0 disables the scanner.
+  *
+  * @param  PCA9745_Diag *d, PCA9745 *p, uint8_t budget
+  * @retval None
+  */
+void PCA9745_Diag_Init(PCA9745_Diag *d, PCA9745 *p, uint8_t budget){
+	d->p = p;
+	d->budget = budget;
+	d->next = 0;
+	d->seq = 0;
+	d->scans = 0;
+	for(uint16_t dev = 0; dev < PCA9745_MAX_DEV; dev++){
+		d->status[dev] = (PCA9745_Diag_Status){0};
+	}
+}
+
+/**
+  * @brief  Run the Diagnostics Scanner
+  * @note	Read and publish the next budget registers of the MODE2/EFLAG0 - EFLAG3 scan. Call
+  * 		between animation frames, after the frame has been flushed. Each frame requests the
+  * 		next scan register while MISO returns the previous one, and a final no-op frame
+  * 		collects the last, so budget registers cost budget + 1 frames and no read is left
+  * 		waiting for a later call, whatever the chain sends in between. The scan wraps around,
+  * 		so a budget of 1 publishes one register per call and a complete scan every 5 calls.
+  *
+  * @note	Each frame blocks for one chain transfer (2 * num_dev bytes), waiting for a DMA
+  * 		frame still in flight first.
+  *
+  * @param  PCA9745_Diag *d
+  * @retval uint8_t - chain frames sent
+  */
+uint8_t PCA9745_Diag_Step(PCA9745_Diag *d){
+	PCA9745 *p = d->p;
+	uint8_t pending = _PCA9745_DIAG_NONE;
+	uint8_t frames = 0;
+
+	if(d->budget == 0 || p->num_dev == 0){
+		return 0;
+	}
+	for(uint8_t k = 0; k <= d->budget; k++){
+		uint8_t request = (k < d->budget) ? d->next : _PCA9745_DIAG_NONE;
+		_PCA9745_Read_Frame(p, (request == _PCA9745_DIAG_NONE) ? 0xFF : _PCA9745_Diag_Regs[request]);
+		frames++;
+		if(pending != _PCA9745_DIAG_NONE){
+			_PCA9745_Diag_Publish(d, pending);
+		}
+		pending = request;
+		if(request != _PCA9745_DIAG_NONE){
+			d->next = (d->next + 1) % PCA9745_DIAG_NUM_REGS;
+		}
+	}
+	return frames;
+}
+
+/**
+  * @brief  Get Diagnostics Status of a Device
+  * @note	Copy the latest published status of dev. The copy is retried if the scanner
+  * 		published in the middle of it. Lock free, but must not be called from a context
+  * 		that PCA9745_Diag_Step can never preempt back out of (e.g. a higher priority ISR
+  * 		interrupting the step), in which case it gives up after PCA9745_DIAG_RETRIES.
+  *
+  * @param  PCA9745_Diag *d, uint16_t dev, PCA9745_Diag_Status *s
+  * @retval uint8_t - 1 if s holds a consistent copy, 0 if not yet scanned or the copy failed
+  */
+uint8_t PCA9745_Diag_Get(PCA9745_Diag *d, uint16_t dev, PCA9745_Diag_Status *s){
+	if(dev >= PCA9745_MAX_DEV){
+		return 0;
+	}
+	for(uint8_t i = 0; i < PCA9745_DIAG_RETRIES; i++){
+		uint32_t seq = d->seq;
+		__DMB();
+		*s = d->status[dev];
+		uint32_t scans = d->scans;
+		__DMB();
+		if((seq & 0x01) == 0 && seq == d->seq){
+			return scans > 0;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * pca9745_diag.h
+ *
+ *  Created on: Jun 23, 2021
+ *      Author: THollis
+ */
+
+#ifndef INC_PCA9745_PCA9745_DIAG_H_
+#define INC_PCA9745_PCA9745_DIAG_H_
+
+#include "pca9745.h"
+
+#define PCA9745_DIAG_NUM_REGS	5		//MODE2, EFLAG0 - EFLAG3
+#define PCA9745_DIAG_RETRIES	4		//snapshot copies attempted by PCA9745_Diag_Get
+
+typedef struct {
+	uint16_t open;			//1 - channel reported open circuit
+	uint16_t shorted;		//1 - channel reported short circuit
+	uint8_t overtemp;		//1 - MODE2 OVERTEMP set
+	uint8_t error;			//1 - MODE2 ERROR set
+} PCA9745_Diag_Status;
+
+typedef struct {
+	PCA9745 *p;
+	uint8_t budget;				//scan registers per PCA9745_Diag_Step, 0 - disabled
+	uint8_t next;				//scan register requested first by the next step
+
+	//Snapshot, written by PCA9745_Diag_Step only
+	volatile uint32_t seq;		//odd while status[] is being updated
+	volatile uint32_t scans;	//complete MODE2/EFLAG scans published
+	PCA9745_Diag_Status status[PCA9745_MAX_DEV];
+} PCA9745_Diag;
+
+void PCA9745_Diag_Init(PCA9745_Diag *d, PCA9745 *p, uint8_t budget);
+uint8_t PCA9745_Diag_Step(PCA9745_Diag *d);
+uint8_t PCA9745_Diag_Get(PCA9745_Diag *d, uint16_t dev, PCA9745_Diag_Status *s);
+
+#endif /* INC_PCA9745_PCA9745_DIAG_H_ */
@@ -0,0 +1,238 @@
+/*
+ * pca9745_grad.c
+ *
+ *  Created on: Jun 23, 2021
+ *      Author: THollis
+ */
+
+#include "main.h"
+#include "pca9745_grad.h"
+#include "pca9745_instr.h"
+#include "pca9745_io.h"
+
+#define _PCA9745_GRAD_STRIDE	(RAMP_RATE_GRP1 - RAMP_RATE_GRP0)	//registers between groups
+
+//HOLD_CNTL ON/OFF time codes in ms
+static const uint16_t _PCA9745_Grad_Hold_ms[8] = {0, 250, 500, 750, 1000, 2000, 4000, 6000};
+
+static uint8_t _PCA9745_Grad_Expired(uint32_t end, uint32_t now){
+	return (int32_t)(now - end) >= 0;
+}
+
+//Read-modify-stage of a shadowed register, unknown registers read as their reset value 0x00
+static void _PCA9745_Grad_Modify(PCA9745 *p, uint16_t dev, uint8_t reg, uint8_t mask, uint8_t value){
+	uint8_t data = 0x00;
+	PCA9745_Get_Shadow(p, dev, reg, &data);
+	PCA9745_Stage(p, dev, reg, (data & ~mask) | (value & mask));
+}
+
+//1 - the group's registers already hold the profile (sent or staged)
+static uint8_t _PCA9745_Grad_Holds(PCA9745 *p, uint16_t dev, uint8_t grp, const PCA9745_Grad_Profile *prof){
+	const uint8_t want[4] = {prof->ramp_rate, prof->step_time, prof->hold, prof->iref};
+	for(uint8_t k = 0; k < 4; k++){
+		uint8_t data;
+		if(!PCA9745_Get_Shadow(p, dev, RAMP_RATE_GRP0 + grp * _PCA9745_GRAD_STRIDE + k, &data) || data != want[k]){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+  * @brief  Pick a Gradation Group
+  * @note	In order of preference:
+  * 			1. A group started with the same profile in this same ms, the LEDs join its ramp.
+  * 			2. An idle group already programmed with the profile, nothing to rewrite.
+  * 			3. The idle group that finished first.
+  * 		A running group is never taken, starting it again would restart its other LEDs.
+  *
+  * @param  PCA9745_Grad *g, uint16_t dev, const PCA9745_Grad_Profile *prof, uint32_t now, uint32_t end
+  * @retval uint8_t - group, PCA9745_GRAD_NONE if all groups are running
+  */
+static uint8_t _PCA9745_Grad_Find(PCA9745_Grad *g, uint16_t dev, const PCA9745_Grad_Profile *prof, uint32_t now, uint32_t end){
+	uint8_t best = PCA9745_GRAD_NONE;
+	for(uint8_t grp = 0; grp < PCA9745_GRAD_NUM_GRP; grp++){
+		if(g->end[dev][grp] == end && _PCA9745_Grad_Holds(g->p, dev, grp, prof)){
+			return grp;
+		}
+	}
+	for(uint8_t grp = 0; grp < PCA9745_GRAD_NUM_GRP; grp++){
+		if(!_PCA9745_Grad_Expired(g->end[dev][grp], now)){
+			continue;
+		}
+		if(_PCA9745_Grad_Holds(g->p, dev, grp, prof)){
+			return grp;
+		}
+		if(best == PCA9745_GRAD_NONE || (int32_t)(g->end[dev][grp] - g->end[dev][best]) < 0){
+			best = grp;
+		}
+	}
+	return best;
+}
+
+/**
+  * @brief  Initialize the Gradation Allocator
+  * @note	All groups of every device start out idle. The gradation registers are left as they
+  * 		are, the shadow register file decides what has to be written.
+  *
+  * @param  PCA9745_Grad *g, PCA9745 *p
+  * @retval None
+  */
+void PCA9745_Grad_Init(PCA9745_Grad *g, PCA9745 *p){
+	uint32_t now = HAL_GetTick();
+	g->p = p;
+	for(uint16_t dev = 0; dev < PCA9745_MAX_DEV; dev++){
+		for(uint8_t grp = 0; grp < PCA9745_GRAD_NUM_GRP; grp++){
+			g->end[dev][grp] = now;
+		}
+	}
+}
+
+/**
+  * @brief  Make a Gradation Profile
+  * @note	Single shot: ramp the current from 0 up to iref, hold for hold_ms, ramp back down to 0.
+  * 		The ramp up and down share RAMP_RATE and STEP_TIME, so both take ramp_ms. A ramp is
+  * 		ceil(iref / (rate + 1)) steps of (factor + 1) * 0.5 ms or 8 ms, the closest of the
+  * 		64 * 64 * 2 combinations to ramp_ms is chosen, preferring the smallest rate (finest
+  * 		steps). hold_ms is rounded to the nearest HOLD_CNTL time (0 - 6 s).
+  *
+  * @note	Quantizing here is what lets LEDs share a group, e.g. ramps of 1000 ms and 1010 ms
+  * 		give the same registers.
+  *
+  * @param  uint8_t iref, uint32_t ramp_ms, uint32_t hold_ms
+  * @retval PCA9745_Grad_Profile
+  */
+PCA9745_Grad_Profile PCA9745_Grad_Make_Profile(uint8_t iref, uint32_t ramp_ms, uint32_t hold_ms){
+	PCA9745_Grad_Profile prof = {0};
+	uint32_t target = ramp_ms * 2;		//in 0.5 ms
+	uint32_t best_err = 0xFFFFFFFFUL;
+
+	for(uint8_t rate = 0; rate < 64; rate++){
+		uint32_t steps = (iref + rate) / (rate + 1);
+		if(steps == 0){
+			steps = 1;
+		}
+		for(uint8_t cycle = 0; cycle < 2; cycle++){
+			uint32_t unit = steps * (cycle ? 16 : 1);
+			uint32_t factor = (target + unit / 2) / unit;
+			factor = (factor < 1) ? 1 : (factor > 64) ? 64 : factor;
+			uint32_t t = unit * factor;
+			uint32_t err = (t > target) ? t - target : target - t;
+			if(err < best_err){
+				best_err = err;
+				prof.ramp_rate = 0xC0 | rate;
+				prof.step_time = (cycle ? 0x40 : 0x00) | (factor - 1);
+			}
+		}
+	}
+
+	if(hold_ms > 0){
+		uint8_t code = 0;
+		for(uint8_t k = 1; k < 8; k++){
+			uint32_t d = (hold_ms > _PCA9745_Grad_Hold_ms[k]) ? hold_ms - _PCA9745_Grad_Hold_ms[k] : _PCA9745_Grad_Hold_ms[k] - hold_ms;
+			uint32_t best = (hold_ms > _PCA9745_Grad_Hold_ms[code]) ? hold_ms - _PCA9745_Grad_Hold_ms[code] : _PCA9745_Grad_Hold_ms[code] - hold_ms;
+			if(d < best){
+				code = k;
+			}
+		}
+		prof.hold = 0x80 | (code << 3);
+	}
+	prof.iref = iref;
+	return prof;
+}
+
+/**
+  * @brief  Gradation Duration
+  * @note	Length of one single shot of the profile in ms, rounded up.
+  *
+  * @param  const PCA9745_Grad_Profile *prof
+  * @retval uint32_t
+  */
+uint32_t PCA9745_Grad_Duration(const PCA9745_Grad_Profile *prof){
+	uint32_t rate = (prof->ramp_rate & 0x3F) + 1;
+	uint32_t steps = (prof->iref + rate - 1) / rate;
+	uint32_t step = ((prof->step_time & 0x3F) + 1) * ((prof->step_time & 0x40) ? 16 : 1);	//in 0.5 ms
+	uint32_t hold = (prof->hold & 0x80) ? _PCA9745_Grad_Hold_ms[(prof->hold >> 3) & 0x07] : 0;
+	return steps * step + hold + 1;		//two ramps of steps * step / 2 ms
+}
+
+/**
+  * @brief  Start a Hardware Fade
+  * @note	Put the channels in gradation mode on a group running the profile and start it, after
+  * 		which the device fades them on its own and no further writes are needed. The output is
+  * 		the group's ramped current times each channel's PWMx, so the PWM registers set the colour
+  * 		and the profile the envelope.
+  *
+  * @note	The group is chosen automatically (see _PCA9745_Grad_Find). Reprogramming is skipped
+  * 		when the group already holds the profile, and LEDs faded with the same profile in the
+  * 		same ms share a group. Only gradation registers that change are staged, and they go out
+  * 		ordered by address, so GRAD_CNTL is always last. In deferred mode the writes of many
+  * 		devices share frames.
+  *
+  * @note	GRAD_CNTL is written with the START bit of every group still running, writing 1 to a
+  * 		running group leaves it running. channels uses the same numbering as PCA9745_Set_PWMx.
+  *
+  * @param  PCA9745_Grad *g, uint16_t dev, uint16_t channels (bit mask), const PCA9745_Grad_Profile *prof
+  * @retval uint8_t - group used, PCA9745_GRAD_NONE if all four groups are running
+  */
+uint8_t PCA9745_Grad_Fade(PCA9745_Grad *g, uint16_t dev, uint16_t channels, const PCA9745_Grad_Profile *prof){
+	PCA9745 *p = g->p;
+	uint32_t now = HAL_GetTick();
+	uint32_t end = now + PCA9745_Grad_Duration(prof);
+	uint8_t grp = _PCA9745_Grad_Find(g, dev, prof, now, end);
+	if(grp == PCA9745_GRAD_NONE){
+		return PCA9745_GRAD_NONE;
+	}
+
+	uint8_t base = grp * _PCA9745_GRAD_STRIDE;
+	PCA9745_Stage(p, dev, RAMP_RATE_GRP0 + base, prof->ramp_rate);
+	PCA9745_Stage(p, dev, STEP_TIME_GRP0 + base, prof->step_time);
+	PCA9745_Stage(p, dev, HOLD_CNTL_GRP0 + base, prof->hold);
+	PCA9745_Stage(p, dev, IREF_GRP0 + base, prof->iref);
+	g->end[dev][grp] = end;
+
+	for(uint8_t ch = 0; ch < 16; ch++){
+		if(channels & (0x01 << ch)){
+			uint8_t out = 15 - ch;
+			_PCA9745_Grad_Modify(p, dev, GRAD_GRP_SEL0 + out / 4, 0x03 << ((out % 4) * 2), grp << ((out % 4) * 2));
+			_PCA9745_Grad_Modify(p, dev, GRAD_MODE_SEL0 + out / 8, 0x01 << (out % 8), 0xFF);
+		}
+	}
+
+	uint8_t cntl = 0x00;
+	for(uint8_t k = 0; k < PCA9745_GRAD_NUM_GRP; k++){
+		if(!_PCA9745_Grad_Expired(g->end[dev][k], now)){
+			cntl |= 0x02 << (k * 2);		//START, single shot
+		}
+	}
+	PCA9745_Invalidate_Reg(p, dev, GRAD_CNTL);
+	PCA9745_Stage(p, dev, GRAD_CNTL, cntl);
+	return grp;
+}
+
+/**
+  * @brief  Release Channels from Gradation
+  * @note	Return the channels to normal mode, where their own IREFx sets the current again.
+  * 		Set their PWM first if they should not come back at their old brightness.
+  *
+  * @param  PCA9745_Grad *g, uint16_t dev, uint16_t channels (bit mask)
+  * @retval None
+  */
+void PCA9745_Grad_Release(PCA9745_Grad *g, uint16_t dev, uint16_t channels){
+	for(uint8_t ch = 0; ch < 16; ch++){
+		if(channels & (0x01 << ch)){
+			uint8_t out = 15 - ch;
+			_PCA9745_Grad_Modify(g->p, dev, GRAD_MODE_SEL0 + out / 8, 0x01 << (out % 8), 0x00);
+		}
+	}
+}
+
+/**
+  * @brief  Gradation Group Running
+  *
+  * @param  PCA9745_Grad *g, uint16_t dev, uint8_t grp
+  * @retval uint8_t - 1 while the group's gradation is running
+  */
+uint8_t PCA9745_Grad_Busy(PCA9745_Grad *g, uint16_t dev, uint8_t grp){
+	return !_PCA9745_Grad_Expired(g->end[dev][grp], HAL_GetTick());
+}
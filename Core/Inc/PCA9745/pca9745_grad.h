@@ -0,0 +1,36 @@
+/*
+ * pca9745_grad.h
+ *
+ *  Created on: Jun 23, 2021
+ *      Author: THollis
+ */
+
+#ifndef INC_PCA9745_PCA9745_GRAD_H_
+#define INC_PCA9745_PCA9745_GRAD_H_
+
+#include "pca9745.h"
+
+#define PCA9745_GRAD_NUM_GRP	4		//gradation groups per device
+#define PCA9745_GRAD_NONE		0xFF	//no group available
+
+//Register values of one single shot gradation: ramp up to iref, hold, ramp down to 0
+typedef struct {
+	uint8_t ramp_rate;		//RAMP_RATE_GRPx - ramp up/down enable, IREF step - 1
+	uint8_t step_time;		//STEP_TIME_GRPx - 0.5 ms / 8 ms cycle, cycles per step - 1
+	uint8_t hold;			//HOLD_CNTL_GRPx - hold ON enable and time
+	uint8_t iref;			//IREF_GRPx - peak current
+} PCA9745_Grad_Profile;
+
+typedef struct {
+	PCA9745 *p;
+	uint32_t end[PCA9745_MAX_DEV][PCA9745_GRAD_NUM_GRP];	//HAL_GetTick() when each group's gradation is over
+} PCA9745_Grad;
+
+void PCA9745_Grad_Init(PCA9745_Grad *g, PCA9745 *p);
+PCA9745_Grad_Profile PCA9745_Grad_Make_Profile(uint8_t iref, uint32_t ramp_ms, uint32_t hold_ms);
+uint32_t PCA9745_Grad_Duration(const PCA9745_Grad_Profile *prof);
+uint8_t PCA9745_Grad_Fade(PCA9745_Grad *g, uint16_t dev, uint16_t channels, const PCA9745_Grad_Profile *prof);
+void PCA9745_Grad_Release(PCA9745_Grad *g, uint16_t dev, uint16_t channels);
+uint8_t PCA9745_Grad_Busy(PCA9745_Grad *g, uint16_t dev, uint8_t grp);
+
+#endif /* INC_PCA9745_PCA9745_GRAD_H_ */
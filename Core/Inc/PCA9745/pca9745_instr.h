@@ -44,7 +44,7 @@
 #define IREF4		0x1C
 #define IREF5		0x1D
 #define IREF6		0x1E
-#define IREF7		0x0F
+#define IREF7		0x1F
 #define IREF8		0x20
 #define IREF9		0x21
 #define IREF10		0x22
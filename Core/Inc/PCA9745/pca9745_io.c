@@ -6,26 +6,115 @@
  */
 
 #include "pca9745_io.h"
+#include "pca9745_pump.h"
 #include "main.h"
 
+static void _PCA9745_REG_Transmit(SPI_TypeDef *spi, uint8_t *tx, uint16_t len){
+	spi->CR1 |= SPI_CR1_SPE;
+	for(uint16_t i = 0; i < len; i++){
+		while(!(spi->SR & SPI_SR_TXE));
+		*(__IO uint8_t *)&spi->DR = tx[i];
+	}
+	while(!(spi->SR & SPI_SR_TXE));
+	while(spi->SR & SPI_SR_BSY);
+	(void)spi->DR;		//Clear the overrun left by the unread MISO bytes
+	(void)spi->SR;
+}
+
+static void _PCA9745_REG_TransmitReceive(SPI_TypeDef *spi, uint8_t *tx, uint8_t *rx, uint16_t len){
+	spi->CR1 |= SPI_CR1_SPE;
+	while(spi->SR & SPI_SR_RXNE){
+		(void)spi->DR;
+	}
+	for(uint16_t i = 0; i < len; i++){
+		while(!(spi->SR & SPI_SR_TXE));
+		*(__IO uint8_t *)&spi->DR = tx[i];
+		while(!(spi->SR & SPI_SR_RXNE));
+		rx[i] = *(__IO uint8_t *)&spi->DR;
+	}
+	while(spi->SR & SPI_SR_BSY);
+}
+
+static void _PCA9745_SPI_Transmit(PCA9745 *p, uint8_t *tx, uint16_t len){
+#if PCA9745_SPI_BACKEND == PCA9745_SPI_REG
+	_PCA9745_REG_Transmit(p->hspi->Instance, tx, len);
+#else
+	HAL_SPI_Transmit(p->hspi, tx, len, PCA9745_XFR_DELAY);
+#endif
+}
+
+static void _PCA9745_SPI_TransmitReceive(PCA9745 *p, uint8_t *tx, uint8_t *rx, uint16_t len){
+#if PCA9745_SPI_BACKEND == PCA9745_SPI_REG
+	_PCA9745_REG_TransmitReceive(p->hspi->Instance, tx, rx, len);
+#else
+	HAL_SPI_TransmitReceive(p->hspi, tx, rx, len, PCA9745_XFR_DELAY);
+#endif
+}
+
 PCA9745 Init_PCA9745(SPI_HandleTypeDef *hspi, GPIO_TypeDef *nCS_port, uint16_t nCS_pin, GPIO_TypeDef *nOE_port,	uint16_t nOE_pin){
 	PCA9745 p;
 
 	_PCA9745_Set_SPI(&p, hspi);
 	_PCA9745_Set_CS(&p, nCS_port, nCS_pin);
 	_PCA9745_Set_OE(&p, nOE_port, nOE_pin);
-	_PCA9745_OE(&p, 0);
+	p.dma = 0;
+	p.busy = 0;
+	p.frame_count = 0;
+	p.deferred = 0;
+	p.pump = NULL;
+	_PCA9745_OE(&p, 1);		//outputs off until the chain is programmed
+
+	//Cycle counter for the _PCA9745_Wait timeout
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 
 	return p;
 }
 
-void _PCA9745_Configure(PCA9745 *p, float r_ext, uint16_t num_dev, uint8_t *instr_buffer, uint8_t *data_buffer, uint8_t *rx_buffer){
-	p->instr_buffer = instr_buffer;
-	p->data_buffer = data_buffer;
-	p->rx_buffer = rx_buffer;
+/**
+  * @brief  Configure the Chain
+  * @note	Attach the working memory arena and set the external resistor and chain length.
+  * 		The chain length can be changed later with _PCA9745_Set_Num_Dev.
+  *
+  * @param  PCA9745 *p, float r_ext, uint16_t num_dev, PCA9745_Arena *arena
+  * @retval None
+  */
+void _PCA9745_Configure(PCA9745 *p, float r_ext, uint16_t num_dev, PCA9745_Arena *arena){
+	p->arena = arena;
+	p->instr_buffer = arena->instr_buffer;
+	p->data_buffer = arena->data_buffer;
+	p->rx_buffer = arena->rx_buffer;
+	p->frame_buffer = arena->frame_buffer;
+	p->shadow = arena->shadow;
+	p->frame_index = 0;
+	p->deferred = 0;
 
 	p->r_ext = r_ext;
+	p->num_dev = 0;
+	_PCA9745_Set_Num_Dev(p, num_dev);
+}
+
+/**
+  * @brief  Set the Chain Length
+  * @note	Set the number of devices in the chain at runtime, clamped to PCA9745_MAX_DEV.
+  * 		Devices added to the chain start with an unknown (invalid) shadow.
+  *
+  * @param  PCA9745 *p, uint16_t num_dev
+  * @retval None
+  */
+void _PCA9745_Set_Num_Dev(PCA9745 *p, uint16_t num_dev){
+	if(num_dev > PCA9745_MAX_DEV){
+		num_dev = PCA9745_MAX_DEV;
+	}
+	_PCA9745_Wait(p);
+	for(uint16_t i = p->num_dev; i < num_dev; i++){
+		for(uint8_t j = 0; j < PCA9745_SHADOW_SIZE / 8; j++){
+			p->shadow[i].valid[j] = 0x00;
+			p->shadow[i].dirty[j] = 0x00;
+		}
+	}
 	p->num_dev = num_dev;
+	p->frame_index = 0;
 }
 
 void _PCA9745_CS(PCA9745 *p, uint8_t state){
@@ -36,31 +125,219 @@ void _PCA9745_OE(PCA9745 *p, uint8_t state){
 	HAL_GPIO_WritePin(p->gpio_port_nOE, p->gpio_pin_nOE, state);
 }
 
+/**
+  * @brief  Write a Chain Frame
+  * @note	Packs one instruction/data pair per device into the frame buffer and shifts the
+  * 		whole 2 * num_dev byte frame out in a single SPI transfer.
+  *
+  * @note	With DMA enabled the frame is built into the idle half of the double buffer while the
+  * 		previous frame is still draining, then started with HAL_SPI_Transmit_DMA and this
+  * 		function returns. nCS is released in _PCA9745_TxCplt. The instruction and data arrays
+  * 		are free to be reused as soon as this returns.
+  *
+  * @note	While a frame pump is capturing (see PCA9745_Pump_Begin) the frame is appended to its
+  * 		frame list instead.
+  *
+  * @param  PCA9745 *p, uint8_t *instruction, uint8_t *data
+  * @retval None
+  */
 void _PCA9745_Write(PCA9745 *p, uint8_t *instruction, uint8_t *data){
-	uint8_t transfer_buffer[2];
-	_PCA9745_CS(p, 0);
-	for(uint16_t i = 0; i < p->num_dev;i++){
-		transfer_buffer[0] = (instruction[i] << 1) | 0x00;
-		transfer_buffer[1] = data[i];
-		HAL_SPI_Transmit(p->hspi, transfer_buffer, sizeof(transfer_buffer), PCA9745_XFR_DELAY);
+	if(p->pump != NULL && p->pump->capture){
+		_PCA9745_Build_Frame(p, instruction, data, _PCA9745_Pump_Next(p->pump));
+		p->frame_count++;
+		return;
+	}
+
+	uint8_t *frame = p->frame_buffer + p->frame_index * 2 * p->num_dev;
+	_PCA9745_Build_Frame(p, instruction, data, frame);
+	p->frame_count++;
+	if(p->dma == 1){
+		_PCA9745_Wait(p);
+		p->busy = 1;
+		_PCA9745_CS(p, 0);
+		if(HAL_SPI_Transmit_DMA(p->hspi, frame, 2 * p->num_dev) != HAL_OK){
+			_PCA9745_CS(p, 1);
+			p->busy = 0;
+		}
+		p->frame_index ^= 1;
+	}
+	else{
+		_PCA9745_CS(p, 0);
+		_PCA9745_SPI_Transmit(p, frame, 2 * p->num_dev);
+		_PCA9745_CS(p, 1);
 	}
-	_PCA9745_CS(p, 1);
 }
 
+/**
+  * @brief  Build a Chain Frame
+  * @note	Device i occupies bytes 2i (instruction, write bit cleared) and 2i + 1 (data),
+  * 		in the same order the per-device transfers were previously shifted out.
+  *
+  * @param  PCA9745 *p, uint8_t *instruction, uint8_t *data, uint8_t *frame
+  * @retval None
+  */
+void _PCA9745_Build_Frame(PCA9745 *p, uint8_t *instruction, uint8_t *data, uint8_t *frame){
+	for(uint16_t i = 0; i < p->num_dev; i++){
+		frame[i * 2 + 0] = (instruction[i] << 1) | 0x00;
+		frame[i * 2 + 1] = data[i];
+	}
+}
+
+/**
+  * @brief  Read a Register
+  * @note	Reads one register from every device into rx_buffer (one byte per device).
+  * 		Takes two chain frames: the read request and the frame that returns its data.
+  *
+  * @param  PCA9745 *p, uint8_t instruction
+  * @retval None
+  */
 void _PCA9745_Read(PCA9745 *p, uint8_t instruction){
-	uint8_t transfer_buffer[] = {(instruction << 1) | 0x01, 0xFF};
-	_PCA9745_CS(p, 0);
+	_PCA9745_Read_Frame(p, instruction);
+	_PCA9745_Read_Frame(p, 0xFF);
+}
+
+/**
+  * @brief  Read Multiple Registers
+  * @note	Pipelined read of n registers from every device. Each frame requests the next
+  * 		register while MISO returns the one requested by the previous frame, so n registers
+  * 		take n + 1 frames. The result is stored as out[register][device], n * num_dev bytes.
+  *
+  * @param  PCA9745 *p, const uint8_t *instructions, uint8_t n, uint8_t *out
+  * @retval None
+  */
+void _PCA9745_Read_Multi(PCA9745 *p, const uint8_t *instructions, uint8_t n, uint8_t *out){
+	for(uint8_t k = 0; k <= n; k++){
+		_PCA9745_Read_Frame(p, (k < n) ? instructions[k] : 0xFF);
+		if(k > 0){
+			for(uint16_t i = 0; i < p->num_dev; i++){
+				out[(k - 1) * p->num_dev + i] = p->rx_buffer[i];
+			}
+		}
+	}
+}
+
+/**
+  * @brief  Shift One Read Frame
+  * @note	Sends a read request for instruction to every device (0xFF sends the no-op instead)
+  * 		with a full-duplex transfer. The data returned on MISO belongs to the request of the
+  * 		previous frame and is stored in rx_buffer, one byte per device.
+  *
+  * @param  PCA9745 *p, uint8_t instruction
+  * @retval None
+  */
+void _PCA9745_Read_Frame(PCA9745 *p, uint8_t instruction){
+	uint8_t *tx = p->frame_buffer;
+	uint8_t *rx = p->frame_buffer + 2 * p->num_dev;
+	_PCA9745_Wait(p);	//a DMA write may still be shifting out of the same buffer
 	for(uint16_t i = 0; i < p->num_dev; i++){
-		HAL_SPI_Transmit(p->hspi, transfer_buffer, sizeof(transfer_buffer), PCA9745_XFR_DELAY);
+		tx[i * 2 + 0] = (instruction == 0xFF) ? 0xFE : (instruction << 1) | 0x01;
+		tx[i * 2 + 1] = 0xFF;
 	}
+	_PCA9745_Transfer(p, tx, rx);
+	for(uint16_t i = 0; i < p->num_dev; i++){
+		p->rx_buffer[i] = rx[i * 2 + 1];
+	}
+}
+
+/**
+  * @brief  Full-Duplex Chain Transfer
+  * @note	Shifts 2 * num_dev bytes out of tx while receiving into rx and waits for completion.
+  * 		Uses HAL_SPI_TransmitReceive_DMA when DMA is enabled.
+  *
+  * @param  PCA9745 *p, uint8_t *tx, uint8_t *rx
+  * @retval None
+  */
+void _PCA9745_Transfer(PCA9745 *p, uint8_t *tx, uint8_t *rx){
+	_PCA9745_Wait(p);
+	p->frame_count++;
+	_PCA9745_CS(p, 0);
+	if(p->dma == 1){
+		p->busy = 1;
+		if(HAL_SPI_TransmitReceive_DMA(p->hspi, tx, rx, 2 * p->num_dev) != HAL_OK){
+			_PCA9745_CS(p, 1);
+			p->busy = 0;
+		}
+		_PCA9745_Wait(p);
+	}
+	else{
+		_PCA9745_SPI_TransmitReceive(p, tx, rx, 2 * p->num_dev);
+		_PCA9745_CS(p, 1);
+	}
+}
+
+/**
+  * @brief  Wait for the DMA Pipeline
+  * @note	Blocks until the frame in flight (if any) has been shifted out and nCS released.
+  * 		If the transfer does not complete within PCA9745_XFR_DELAY ms it is aborted.
+  *
+  * @note	The SPI DMA interrupt must be able to preempt the caller. The timeout runs on the
+  * 		DWT cycle counter rather than HAL_GetTick, so it also expires when called from an
+  * 		interrupt at or above the SysTick priority.
+  *
+  * @param  PCA9745 *p
+  * @retval None
+  */
+void _PCA9745_Wait(PCA9745 *p){
+	uint32_t start = DWT->CYCCNT;
+	uint32_t timeout = SystemCoreClock / 1000 * PCA9745_XFR_DELAY;
+	while(p->busy == 1){
+		if(DWT->CYCCNT - start > timeout){
+			if(p->pump != NULL && p->pump->running){
+				PCA9745_Pump_Abort(p->pump);
+			}
+			else{
+				HAL_SPI_DMAStop(p->hspi);
+				_PCA9745_CS(p, 1);
+				p->busy = 0;
+			}
+		}
+	}
+}
+
+/**
+  * @brief  DMA Transmit Complete
+  * @note	Call from HAL_SPI_TxCpltCallback and HAL_SPI_TxRxCpltCallback. Releases nCS, latching the frame into the chain,
+  * 		and frees the pipeline for the next frame.
+  *
+  * @param  PCA9745 *p, SPI_HandleTypeDef *hspi
+  * @retval None
+  */
+void _PCA9745_TxCplt(PCA9745 *p, SPI_HandleTypeDef *hspi){
+	if(hspi == p->hspi && p->busy == 1){
+		_PCA9745_CS(p, 1);
+		p->busy = 0;
+	}
+}
+
+/**
+  * @brief  Benchmark the SPI Backends
+  * @note	Shifts one no-op chain frame (2 * num_dev bytes, nCS framing included) through
+  * 		HAL_SPI_Transmit and through direct register access, and reports the cycles each
+  * 		took using the DWT cycle counter. Blocking, call with DMA idle.
+  *
+  * @param  PCA9745 *p, uint32_t *hal_cycles, uint32_t *reg_cycles
+  * @retval None
+  */
+void _PCA9745_Benchmark(PCA9745 *p, uint32_t *hal_cycles, uint32_t *reg_cycles){
+	uint32_t start;
+	_PCA9745_Wait(p);
+	for(uint16_t i = 0; i < 2 * p->num_dev; i++){
+		p->frame_buffer[i] = 0xFF;
+	}
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	start = DWT->CYCCNT;
+	_PCA9745_CS(p, 0);
+	HAL_SPI_Transmit(p->hspi, p->frame_buffer, 2 * p->num_dev, PCA9745_XFR_DELAY);
 	_PCA9745_CS(p, 1);
+	*hal_cycles = DWT->CYCCNT - start;
+
+	start = DWT->CYCCNT;
 	_PCA9745_CS(p, 0);
-	uint8_t receive_buffer[2 * p->num_dev];
-	HAL_SPI_Receive(p->hspi, receive_buffer, sizeof(receive_buffer), PCA9745_XFR_DELAY);
+	_PCA9745_REG_Transmit(p->hspi->Instance, p->frame_buffer, 2 * p->num_dev);
 	_PCA9745_CS(p, 1);
-	for(uint16_t i = 0; i < p->num_dev; i++){
-		p->rx_buffer[i] = receive_buffer[i * 2 + 1];
-	}
+	*reg_cycles = DWT->CYCCNT - start;
 }
 
 void _PCA9745_Format_Data(PCA9745 *p, uint16_t dev, uint8_t instruction, uint8_t data){
@@ -80,6 +357,11 @@ void _PCA9745_Set_SPI(PCA9745 *p, SPI_HandleTypeDef *hspi){
 	p->hspi = hspi;
 }
 
+void _PCA9745_Set_DMA(PCA9745 *p, uint8_t state){
+	_PCA9745_Wait(p);
+	p->dma = state;
+}
+
 void _PCA9745_Set_CS(PCA9745 *p, GPIO_TypeDef *port, uint16_t pin){
 	p->gpio_port_nCS = port;
 	p->gpio_pin_nCS = pin;
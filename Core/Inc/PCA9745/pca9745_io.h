@@ -12,6 +12,13 @@
 
 #define PCA9745_XFR_DELAY 10
 
+//Blocking SPI backend, DMA transfers always go through the HAL
+#define PCA9745_SPI_HAL	0		//HAL_SPI_Transmit / HAL_SPI_TransmitReceive
+#define PCA9745_SPI_REG	1		//Direct SPI DR/SR register access
+#ifndef PCA9745_SPI_BACKEND
+#define PCA9745_SPI_BACKEND PCA9745_SPI_REG
+#endif
+
 typedef enum{
 	NO_ERROR,
 	SHORT_CIRCUIT,
@@ -19,6 +26,30 @@ typedef enum{
 	DNE
 } PCA9745_Error_TypeDef;
 
+#ifndef PCA9745_MAX_DEV
+#define PCA9745_MAX_DEV 256		//longest chain supported, sizes PCA9745_Arena
+#endif
+
+#define PCA9745_SHADOW_SIZE	0x40	//MODE1 through OFFSET, covers PWMx, IREFx, LEDOUTx and GRP*
+
+typedef struct {
+	uint8_t reg[PCA9745_SHADOW_SIZE];			//Last value written (or staged) per register
+	uint8_t sent[PCA9745_SHADOW_SIZE];			//Last value written to the device per register
+	uint8_t valid[PCA9745_SHADOW_SIZE / 8];		//1 - sent[] matches the device
+	uint8_t dirty[PCA9745_SHADOW_SIZE / 8];		//1 - reg[] is staged but not yet sent
+} PCA9745_Shadow;
+
+//All per-chain working memory, sized for PCA9745_MAX_DEV devices. Place statically in DMA
+//capable SRAM (not CCM RAM).
+typedef struct {
+	uint8_t instr_buffer[PCA9745_MAX_DEV];
+	uint8_t data_buffer[PCA9745_MAX_DEV];
+	uint8_t rx_buffer[PCA9745_MAX_DEV];
+	uint8_t scratch[PCA9745_MAX_DEV];			//Free for callers between driver calls
+	uint8_t frame_buffer[2 * 2 * PCA9745_MAX_DEV];
+	PCA9745_Shadow shadow[PCA9745_MAX_DEV];
+} PCA9745_Arena;
+
 typedef struct {
 	SPI_HandleTypeDef *hspi;
 	GPIO_TypeDef *gpio_port_nCS;
@@ -29,17 +60,40 @@ typedef struct {
 	//Must include for PCA9745.c to compile
 	float r_ext;			//External Resistor value
 	uint16_t num_dev;		//number of devices
+	PCA9745_Arena *arena;
 	uint8_t *instr_buffer;
 	uint8_t *data_buffer;
 	uint8_t *rx_buffer;
+	uint8_t *frame_buffer;	//4 * num_dev bytes, two chain frames (double buffer)
+
+	//DMA write pipeline
+	uint8_t dma;				//1 - writes are started with HAL_SPI_Transmit_DMA
+	uint8_t frame_index;		//frame buffer the next write is built into
+	volatile uint8_t busy;		//1 - a DMA frame is in flight, nCS is held low
+	volatile uint32_t frame_count;	//chain frames started, lets readers detect interleaved traffic
+
+	//Shadow register file
+	PCA9745_Shadow *shadow;		//num_dev entries
+	uint8_t deferred;			//1 - register writes are staged until PCA9745_Flush
+
+	struct PCA9745_Pump *pump;	//timer driven frame pump, see pca9745_pump.h, NULL - none
 } PCA9745;
 
 PCA9745 Init_PCA9745(SPI_HandleTypeDef *hspi, GPIO_TypeDef *nCS_port, uint16_t nCS_pin, GPIO_TypeDef *nOE_port,	uint16_t nOE_pin);
-void _PCA9745_Configure(PCA9745 *p, float r_ext, uint16_t num_dev, uint8_t *instr_buffer, uint8_t *data_buffer, uint8_t *rx_buffer);
+void _PCA9745_Configure(PCA9745 *p, float r_ext, uint16_t num_dev, PCA9745_Arena *arena);
+void _PCA9745_Set_Num_Dev(PCA9745 *p, uint16_t num_dev);
 void _PCA9745_CS(PCA9745 *p, uint8_t state);
 void _PCA9745_OE(PCA9745 *p, uint8_t state);
 void _PCA9745_Write(PCA9745 *p, uint8_t *instruction, uint8_t *data);
+void _PCA9745_Build_Frame(PCA9745 *p, uint8_t *instruction, uint8_t *data, uint8_t *frame);
+void _PCA9745_Wait(PCA9745 *p);
+void _PCA9745_TxCplt(PCA9745 *p, SPI_HandleTypeDef *hspi);
+void _PCA9745_Set_DMA(PCA9745 *p, uint8_t state);
+void _PCA9745_Benchmark(PCA9745 *p, uint32_t *hal_cycles, uint32_t *reg_cycles);
 void _PCA9745_Read(PCA9745 *p, uint8_t instruction);
+void _PCA9745_Read_Multi(PCA9745 *p, const uint8_t *instructions, uint8_t n, uint8_t *out);
+void _PCA9745_Read_Frame(PCA9745 *p, uint8_t instruction);
+void _PCA9745_Transfer(PCA9745 *p, uint8_t *tx, uint8_t *rx);
 void _PCA9745_Format_Data(PCA9745 *p, uint16_t dev, uint8_t instruction, uint8_t data);
 void _PCA9745_Set_SPI(PCA9745 *p, SPI_HandleTypeDef *hspi);
 void _PCA9745_Set_CS(PCA9745 *p, GPIO_TypeDef *port, uint16_t pin);
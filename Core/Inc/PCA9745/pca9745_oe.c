@@ -0,0 +1,193 @@
+/*
+ * pca9745_oe.c
+ *
+ *  Created on: Jun 23, 2021
+ *      Author: THollis
+ */
+
+#include "main.h"
+#include "pca9745_oe.h"
+
+//Output compare mode of the channel, written directly so the channel output is never disabled
+static void _PCA9745_OE_Mode(PCA9745_OE_Timer *o, uint32_t ocmode){
+	volatile uint32_t *ccmr = (o->channel < TIM_CHANNEL_3) ? &o->htim->Instance->CCMR1 : &o->htim->Instance->CCMR2;
+	uint32_t shift = (o->channel & TIM_CHANNEL_2) ? 8 : 0;
+	*ccmr = (*ccmr & ~(TIM_CCMR1_OC1M << shift)) | (ocmode << shift);
+}
+
+static void _PCA9745_OE_Pin(PCA9745_OE_Timer *o, uint8_t timer){
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	GPIO_InitStruct.Pin = o->p->gpio_pin_nOE;
+	GPIO_InitStruct.Mode = timer ? GPIO_MODE_AF_PP : GPIO_MODE_OUTPUT_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+	GPIO_InitStruct.Alternate = o->af;
+	HAL_GPIO_Init(o->p->gpio_port_nOE, &GPIO_InitStruct);
+}
+
+/**
+  * @brief  Initialize the nOE Timer
+  * @note	Set up the timer to count at 1 MHz and the channel as active low PWM (low - outputs
+  * 		enabled) with a duty of 0, then hand the nOE pin from GPIO to the timer. nOE is held
+  * 		high throughout, so the outputs stay off until PCA9745_OE_Set_Duty.
+  * 		The timer clock must be enabled and the timer must not be used for anything else.
+  *
+  * @param  PCA9745_OE_Timer *o, PCA9745 *p, TIM_HandleTypeDef *htim, uint32_t channel, uint8_t af,
+  * 		uint8_t tim_mhz, uint32_t period_us
+  * @retval None
+  */
+void PCA9745_OE_Init(PCA9745_OE_Timer *o, PCA9745 *p, TIM_HandleTypeDef *htim, uint32_t channel, uint8_t af, uint8_t tim_mhz, uint32_t period_us){
+	TIM_OC_InitTypeDef sConfigOC = {0};
+
+	o->p = p;
+	o->htim = htim;
+	o->channel = channel;
+	o->af = af;
+	o->period_us = period_us;
+	o->duty = 0;
+	o->mode = PCA9745_OE_GPIO;
+	_PCA9745_OE(p, 1);
+
+	htim->Init.Prescaler = tim_mhz - 1;
+	htim->Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim->Init.Period = period_us - 1;
+	htim->Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	htim->Init.RepetitionCounter = 0;
+	htim->Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+	HAL_TIM_PWM_Init(htim);
+
+	sConfigOC.OCMode = TIM_OCMODE_PWM1;
+	sConfigOC.Pulse = 0;
+	sConfigOC.OCPolarity = TIM_OCPOLARITY_LOW;
+	sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+	sConfigOC.OCIdleState = TIM_OCIDLESTATE_RESET;
+	HAL_TIM_PWM_ConfigChannel(htim, &sConfigOC, channel);
+	HAL_TIM_PWM_Start(htim, channel);
+
+	_PCA9745_OE_Pin(o, 1);
+	o->mode = PCA9745_OE_DIM;
+}
+
+/**
+  * @brief  Set the nOE Duty Cycle
+  * @note	Enable the outputs for duty / 65536 of every PWM period (0 - off, 0xFFFF - fully on).
+  * 		The compare value is preloaded, so the change takes effect at the end of the current
+  * 		period without a glitch, and costs no SPI traffic. Also ends a strobe, an armed
+  * 		trigger or a release.
+  * 		Keep the period well above the 32 us of the drivers' own PWM so the two do not beat.
+  *
+  * @param  PCA9745_OE_Timer *o, uint16_t duty
+  * @retval None
+  */
+void PCA9745_OE_Set_Duty(PCA9745_OE_Timer *o, uint16_t duty){
+	TIM_TypeDef *tim = o->htim->Instance;
+	uint32_t ccr = (duty == 0xFFFF) ? o->period_us : ((uint32_t)duty * o->period_us + 0x8000) >> 16;
+
+	o->duty = duty;
+	__HAL_TIM_SET_COMPARE(o->htim, o->channel, ccr);
+	if(o->mode != PCA9745_OE_DIM){
+		tim->CR1 &= ~(TIM_CR1_CEN | TIM_CR1_OPM);
+		tim->SMCR &= ~TIM_SMCR_SMS;
+		_PCA9745_OE_Mode(o, TIM_OCMODE_PWM1);
+		tim->ARR = o->period_us - 1;
+		tim->EGR = TIM_EGR_UG;
+		tim->CR1 |= TIM_CR1_CEN;
+		if(o->mode == PCA9745_OE_GPIO){
+			_PCA9745_OE_Pin(o, 1);
+		}
+		o->mode = PCA9745_OE_DIM;
+	}
+}
+
+/**
+  * @brief  Strobe the Outputs
+  * @note	Stop dimming and enable the outputs for a single pulse of width_us, timed by the timer
+  * 		in one pulse mode. The outputs are off before and after the pulse. Call
+  * 		PCA9745_OE_Set_Duty to resume dimming.
+  *
+  * @param  PCA9745_OE_Timer *o, uint16_t width_us
+  * @retval uint8_t - 1 if the pulse was started, 0 if a pulse is still running or width_us is 0
+  */
+uint8_t PCA9745_OE_Strobe(PCA9745_OE_Timer *o, uint16_t width_us){
+	TIM_TypeDef *tim = o->htim->Instance;
+	if(width_us == 0 || PCA9745_OE_Strobe_Busy(o)){
+		return 0;
+	}
+
+	//Hold nOE high while the stopped counter is reloaded, PWM2 against the old CCR/CNT could
+	//enable the outputs for a moment. PWM2 is active from CNT = 1 to ARR, the counter stops at
+	//the update event back on CNT = 0.
+	tim->CR1 &= ~TIM_CR1_CEN;
+	tim->SMCR &= ~TIM_SMCR_SMS;
+	_PCA9745_OE_Mode(o, TIM_OCMODE_FORCED_INACTIVE);
+	__HAL_TIM_SET_COMPARE(o->htim, o->channel, 1);
+	tim->ARR = width_us;
+	tim->CR1 |= TIM_CR1_OPM;
+	tim->EGR = TIM_EGR_UG;
+	_PCA9745_OE_Mode(o, TIM_OCMODE_PWM2);
+	if(o->mode == PCA9745_OE_GPIO){
+		_PCA9745_OE_Pin(o, 1);
+	}
+	o->mode = PCA9745_OE_STROBE;
+	tim->CR1 |= TIM_CR1_CEN;
+	return 1;
+}
+
+/**
+  * @brief  Check for a Running Strobe
+  *
+  * @param  PCA9745_OE_Timer *o
+  * @retval uint8_t - 1 while a strobe pulse is in progress
+  */
+uint8_t PCA9745_OE_Strobe_Busy(PCA9745_OE_Timer *o){
+	return (o->mode == PCA9745_OE_STROBE) && (o->htim->Instance->CR1 & TIM_CR1_CEN);
+}
+
+/**
+  * @brief  Arm a Triggered Strobe
+  * @note	Set up the same pulse as PCA9745_OE_Strobe, but leave the counter stopped in trigger
+  * 		mode, so every rising edge on the trigger input (TIM_TS_ITRx) starts one pulse of
+  * 		width_us with no CPU involvement. The pulse starts one tick (1 us) after the edge. Edges
+  * 		during a pulse are ignored. Call PCA9745_OE_Set_Duty to resume dimming.
+  *
+  * @param  PCA9745_OE_Timer *o, uint16_t width_us, uint32_t trigger
+  * @retval uint8_t - 1 if armed, 0 if width_us is 0
+  */
+uint8_t PCA9745_OE_Arm(PCA9745_OE_Timer *o, uint16_t width_us, uint32_t trigger){
+	TIM_TypeDef *tim = o->htim->Instance;
+	if(width_us == 0){
+		return 0;
+	}
+
+	tim->CR1 &= ~TIM_CR1_CEN;
+	tim->SMCR &= ~TIM_SMCR_SMS;
+	_PCA9745_OE_Mode(o, TIM_OCMODE_FORCED_INACTIVE);		//See PCA9745_OE_Strobe
+	__HAL_TIM_SET_COMPARE(o->htim, o->channel, 1);
+	tim->ARR = width_us;
+	tim->CR1 |= TIM_CR1_OPM;
+	tim->EGR = TIM_EGR_UG;
+	_PCA9745_OE_Mode(o, TIM_OCMODE_PWM2);
+	tim->SMCR = (tim->SMCR & ~TIM_SMCR_TS) | trigger;
+	tim->SMCR |= TIM_SLAVEMODE_TRIGGER;
+	if(o->mode == PCA9745_OE_GPIO){
+		_PCA9745_OE_Pin(o, 1);
+	}
+	o->mode = PCA9745_OE_TRIGGERED;
+	return 1;
+}
+
+/**
+  * @brief  Release nOE to GPIO
+  * @note	Stop the timer and hand nOE back to the GPIO at a static level, see _PCA9745_OE.
+  * 		The level is written before the pin mode changes, so there is no glitch.
+  *
+  * @param  PCA9745_OE_Timer *o, uint8_t state
+  * @retval None
+  */
+void PCA9745_OE_Release(PCA9745_OE_Timer *o, uint8_t state){
+	_PCA9745_OE(o->p, state);
+	_PCA9745_OE_Pin(o, 0);
+	o->htim->Instance->CR1 &= ~TIM_CR1_CEN;
+	o->htim->Instance->SMCR &= ~TIM_SMCR_SMS;
+	o->mode = PCA9745_OE_GPIO;
+}
@@ -0,0 +1,41 @@
+/*
+ * pca9745_oe.h
+ *
+ *  Created on: Jun 23, 2021
+ *      Author: THollis
+ */
+
+#ifndef INC_PCA9745_PCA9745_OE_H_
+#define INC_PCA9745_PCA9745_OE_H_
+
+#include "pca9745.h"
+
+typedef enum {
+	PCA9745_OE_GPIO,		//nOE is a static GPIO output, see _PCA9745_OE
+	PCA9745_OE_DIM,			//nOE is PWMed by the timer channel
+	PCA9745_OE_STROBE,		//nOE is a one-shot pulse of the timer channel
+	PCA9745_OE_TRIGGERED	//nOE is a one-shot pulse started by a trigger input of the timer
+} PCA9745_OE_Mode;
+
+//nOE driven by a timer output compare channel. The nOE pin must have a timer alternate function
+//and an external pull-up, so the outputs stay off while the pin is not driven. The handle must
+//have its Instance set and the timer clock enabled (CubeMX MX_TIMx_Init/HAL_TIM_MspInit),
+//PCA9745_OE_Init configures everything else.
+typedef struct {
+	PCA9745 *p;					//chain whose nOE pin is driven
+	TIM_HandleTypeDef *htim;
+	uint32_t channel;			//TIM_CHANNEL_x of the nOE pin
+	uint8_t af;					//GPIO_AFx_TIMy of the nOE pin
+	uint32_t period_us;			//PWM period in dim mode, the counter runs at 1 MHz
+	uint16_t duty;				//last dim duty, 0 - off, 0xFFFF - fully on
+	PCA9745_OE_Mode mode;
+} PCA9745_OE_Timer;
+
+void PCA9745_OE_Init(PCA9745_OE_Timer *o, PCA9745 *p, TIM_HandleTypeDef *htim, uint32_t channel, uint8_t af, uint8_t tim_mhz, uint32_t period_us);
+void PCA9745_OE_Set_Duty(PCA9745_OE_Timer *o, uint16_t duty);
+uint8_t PCA9745_OE_Strobe(PCA9745_OE_Timer *o, uint16_t width_us);
+uint8_t PCA9745_OE_Strobe_Busy(PCA9745_OE_Timer *o);
+uint8_t PCA9745_OE_Arm(PCA9745_OE_Timer *o, uint16_t width_us, uint32_t trigger);
+void PCA9745_OE_Release(PCA9745_OE_Timer *o, uint8_t state);
+
+#endif /* INC_PCA9745_PCA9745_OE_H_ */
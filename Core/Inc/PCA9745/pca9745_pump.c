@@ -0,0 +1,251 @@
+/*
+ * pca9745_pump.c
+ *
+ *  Created on: Jun 23, 2021
+ *      Author: THollis
+ */
+
+#include "main.h"
+#include "pca9745_pump.h"
+
+//Hand nCS to the timer (1) or back to the GPIO (0), the alternate function is set by init
+static void _PCA9745_Pump_CS_Pin(PCA9745_Pump *u, uint8_t timer){
+	GPIO_TypeDef *port = u->p->gpio_port_nCS;
+	uint32_t pos = __builtin_ctz(u->p->gpio_pin_nCS) * 2;
+	port->MODER = (port->MODER & ~(0x03UL << pos)) | ((timer ? 0x02UL : 0x01UL) << pos);
+}
+
+static void _PCA9745_Pump_Stop(PCA9745_Pump *u){
+	PCA9745 *p = u->p;
+	TIM_TypeDef *slot = u->htim_slot->Instance;
+
+	//Freeze the nCS timer on the last frame, or on its pad if the slot timer got there first
+	slot->CR1 &= ~TIM_CR1_CEN;
+	__HAL_TIM_DISABLE_DMA(u->htim_slot, TIM_DMA_UPDATE);
+	if(u->htim_cs->Instance->CNT < 2U * p->num_dev - 1){
+		u->late++;
+	}
+
+	//Latch the last frame once its last byte is out
+	while(__HAL_SPI_GET_FLAG(p->hspi, SPI_FLAG_TXE) == RESET || __HAL_SPI_GET_FLAG(p->hspi, SPI_FLAG_BSY) != RESET);
+	__HAL_TIM_SET_COMPARE(u->htim_cs, u->cs_channel, 0);
+	_PCA9745_CS(p, 1);
+	_PCA9745_Pump_CS_Pin(u, 0);
+	__HAL_SPI_CLEAR_OVRFLAG(p->hspi);
+
+	u->running = 0;
+	p->busy = 0;
+}
+
+/**
+  * @brief  Initialize the Frame Pump
+  * @note	Attach a frame list and the timers and DMA stream to a chain. The slot timer counts
+  * 		at its input clock, slot_ticks per byte slot and lead_ticks between an nCS edge and
+  * 		the byte following it. The nCS timer counts the slot timer's TRGO on cs_trigger
+  * 		(TIM_TS_ITRx) and drives nCS on cs_channel with alternate function cs_af. The DMA
+  * 		stream and channel are those of the slot timer's update request.
+  * 		nCS stays a GPIO output except while a list is sent. The timer clocks and the DMA
+  * 		stream interrupt must be enabled, and the interrupt must call PCA9745_Pump_IRQHandler.
+  *
+  * @param  PCA9745_Pump *u, PCA9745 *p, uint8_t *list, uint32_t size,
+  * 		TIM_HandleTypeDef *htim_slot, uint32_t slot_ticks, uint32_t lead_ticks,
+  * 		TIM_HandleTypeDef *htim_cs, uint32_t cs_trigger, uint32_t cs_channel, uint8_t cs_af,
+  * 		DMA_Stream_TypeDef *stream, uint32_t dma_channel
+  * @retval None
+  */
+void PCA9745_Pump_Init(PCA9745_Pump *u, PCA9745 *p, uint8_t *list, uint32_t size,
+		TIM_HandleTypeDef *htim_slot, uint32_t slot_ticks, uint32_t lead_ticks,
+		TIM_HandleTypeDef *htim_cs, uint32_t cs_trigger, uint32_t cs_channel, uint8_t cs_af,
+		DMA_Stream_TypeDef *stream, uint32_t dma_channel){
+	TIM_OC_InitTypeDef sConfigOC = {0};
+	TIM_SlaveConfigTypeDef sSlaveConfig = {0};
+	TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+	u->p = p;
+	u->list = list;
+	u->size = size;
+	u->len = 0;
+	u->frames = 0;
+	u->capture = 0;
+	u->htim_slot = htim_slot;
+	u->htim_cs = htim_cs;
+	u->cs_channel = cs_channel;
+	u->running = 0;
+	u->runs = 0;
+	u->late = 0;
+
+	//Slot timer, OC1REF rises lead_ticks before every update
+	htim_slot->Init.Prescaler = 0;
+	htim_slot->Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim_slot->Init.Period = slot_ticks - 1;
+	htim_slot->Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	htim_slot->Init.RepetitionCounter = 0;
+	htim_slot->Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+	HAL_TIM_PWM_Init(htim_slot);
+	sConfigOC.OCMode = TIM_OCMODE_PWM2;
+	sConfigOC.Pulse = slot_ticks - lead_ticks;
+	sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+	sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+	HAL_TIM_PWM_ConfigChannel(htim_slot, &sConfigOC, TIM_CHANNEL_1);
+	sMasterConfig.MasterOutputTrigger = TIM_TRGO_OC1REF;
+	sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+	HAL_TIMEx_MasterConfigSynchronization(htim_slot, &sMasterConfig);
+
+	//nCS timer, low while CNT < compare, compare 0 keeps nCS high. No preload, so the frame
+	//length and compare set by PCA9745_Pump_Start apply at once.
+	htim_cs->Init.Prescaler = 0;
+	htim_cs->Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim_cs->Init.Period = 0xFFFF;
+	htim_cs->Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	htim_cs->Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+	HAL_TIM_PWM_Init(htim_cs);
+	sSlaveConfig.SlaveMode = TIM_SLAVEMODE_EXTERNAL1;
+	sSlaveConfig.InputTrigger = cs_trigger;
+	HAL_TIM_SlaveConfigSynchro(htim_cs, &sSlaveConfig);
+	sConfigOC.OCMode = TIM_OCMODE_PWM1;
+	sConfigOC.Pulse = 0;
+	sConfigOC.OCPolarity = TIM_OCPOLARITY_LOW;
+	HAL_TIM_PWM_ConfigChannel(htim_cs, &sConfigOC, cs_channel);
+	if(cs_channel < TIM_CHANNEL_3){
+		htim_cs->Instance->CCMR1 &= ~(TIM_CCMR1_OC1PE << ((cs_channel & TIM_CHANNEL_2) ? 8 : 0));
+	}
+	else{
+		htim_cs->Instance->CCMR2 &= ~(TIM_CCMR2_OC3PE << ((cs_channel & TIM_CHANNEL_2) ? 8 : 0));
+	}
+	HAL_TIM_PWM_Start(htim_cs, cs_channel);
+
+	//Timer function of the nCS pin, the pin itself stays a GPIO output for now
+	uint32_t pin = __builtin_ctz(p->gpio_pin_nCS);
+	uint32_t shift = (pin & 0x07) * 4;
+	p->gpio_port_nCS->AFR[pin >> 3] = (p->gpio_port_nCS->AFR[pin >> 3] & ~(0x0FUL << shift)) | ((uint32_t)cs_af << shift);
+
+	//List to SPI DR, one byte per slot timer update
+	u->hdma.Instance = stream;
+	u->hdma.Init.Channel = dma_channel;
+	u->hdma.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	u->hdma.Init.PeriphInc = DMA_PINC_DISABLE;
+	u->hdma.Init.MemInc = DMA_MINC_ENABLE;
+	u->hdma.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	u->hdma.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	u->hdma.Init.Mode = DMA_NORMAL;
+	u->hdma.Init.Priority = DMA_PRIORITY_HIGH;
+	u->hdma.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	HAL_DMA_Init(&u->hdma);
+	u->hdma.Parent = u;
+
+	p->pump = u;
+}
+
+/**
+  * @brief  Begin Capturing Frames
+  * @note	Wait for the list in flight, then capture every frame the chain writes into a new list
+  * 		until PCA9745_Pump_Start. Register reads must not be issued while capturing. A chain
+  * 		too long for a single frame in the list is written normally.
+  *
+  * @param  PCA9745_Pump *u
+  * @retval None
+  */
+void PCA9745_Pump_Begin(PCA9745_Pump *u){
+	_PCA9745_Wait(u->p);
+	u->len = 0;
+	u->frames = 0;
+	u->capture = (PCA9745_PUMP_STRIDE(u->p->num_dev) <= u->size);
+}
+
+/**
+  * @brief  Get the Next Frame of the List
+  * @note	Called by _PCA9745_Write while capturing. Reserves the next frame of the list and fills
+  * 		in its pad. If the list is full, the frames captured so far are sent first and the
+  * 		list starts over.
+  *
+  * @param  PCA9745_Pump *u
+  * @retval uint8_t * - where to build the frame
+  */
+uint8_t *_PCA9745_Pump_Next(PCA9745_Pump *u){
+	uint32_t stride = PCA9745_PUMP_STRIDE(u->p->num_dev);
+	if(u->len + stride > u->size){
+		PCA9745_Pump_Start(u);
+		PCA9745_Pump_Begin(u);
+	}
+	uint8_t *frame = u->list + u->len;
+	for(uint8_t k = 0; k < PCA9745_PUMP_PAD; k++){
+		frame[stride - PCA9745_PUMP_PAD + k] = PCA9745_PUMP_PAD_BYTE;
+	}
+	u->len += stride;
+	u->frames++;
+	return frame;
+}
+
+/**
+  * @brief  Send the Captured Frames
+  * @note	Stop capturing and start sending the list. Returns as soon as the timers run, the
+  * 		chain is busy (see _PCA9745_Wait) until the DMA interrupt has latched the last frame.
+  * 		The pad of the last frame is not sent, it is the time the interrupt has to stop the
+  * 		timers before the nCS timer would start another frame.
+  *
+  * @param  PCA9745_Pump *u
+  * @retval uint16_t - frames in the list
+  */
+uint16_t PCA9745_Pump_Start(PCA9745_Pump *u){
+	PCA9745 *p = u->p;
+	TIM_TypeDef *slot = u->htim_slot->Instance;
+	TIM_TypeDef *cs = u->htim_cs->Instance;
+
+	u->capture = 0;
+	if(u->frames == 0){
+		return 0;
+	}
+	_PCA9745_Wait(p);
+	p->busy = 1;
+	u->running = 1;
+
+	//nCS timer parked on the last pad slot, the first slot wraps it to the first frame byte
+	cs->ARR = PCA9745_PUMP_STRIDE(p->num_dev) - 1;
+	cs->CNT = cs->ARR;
+	__HAL_TIM_SET_COMPARE(u->htim_cs, u->cs_channel, 2 * p->num_dev);
+	_PCA9745_CS(p, 1);
+	_PCA9745_Pump_CS_Pin(u, 1);
+
+	slot->CR1 &= ~TIM_CR1_CEN;
+	slot->CNT = 0;
+	__HAL_SPI_ENABLE(p->hspi);
+	HAL_DMA_Start_IT(&u->hdma, (uint32_t)(uintptr_t)u->list, (uint32_t)(uintptr_t)&p->hspi->Instance->DR, u->len - PCA9745_PUMP_PAD);
+	__HAL_TIM_ENABLE_DMA(u->htim_slot, TIM_DMA_UPDATE);
+	slot->CR1 |= TIM_CR1_CEN;
+	u->runs++;
+	return u->frames;
+}
+
+/**
+  * @brief  Abort the List in Flight
+  * @note	Stop the timers and the DMA and release nCS. The frame being shifted is lost.
+  *
+  * @param  PCA9745_Pump *u
+  * @retval None
+  */
+void PCA9745_Pump_Abort(PCA9745_Pump *u){
+	u->htim_slot->Instance->CR1 &= ~TIM_CR1_CEN;
+	__HAL_TIM_DISABLE_DMA(u->htim_slot, TIM_DMA_UPDATE);
+	HAL_DMA_Abort(&u->hdma);
+	__HAL_TIM_SET_COMPARE(u->htim_cs, u->cs_channel, 0);
+	_PCA9745_CS(u->p, 1);
+	_PCA9745_Pump_CS_Pin(u, 0);
+	u->capture = 0;
+	u->running = 0;
+	u->p->busy = 0;
+}
+
+/**
+  * @brief  Frame Pump DMA Interrupt
+  * @note	Call from the IRQ handler of the pump's DMA stream. The timers are stopped before
+  * 		the HAL handler runs, within PCA9745_PUMP_PAD + 1 slots of the last byte.
+  *
+  * @param  PCA9745_Pump *u
+  * @retval None
+  */
+void PCA9745_Pump_IRQHandler(PCA9745_Pump *u){
+	if(u->running && __HAL_DMA_GET_COUNTER(&u->hdma) == 0){
+		_PCA9745_Pump_Stop(u);
+	}
+	HAL_DMA_IRQHandler(&u->hdma);
+}
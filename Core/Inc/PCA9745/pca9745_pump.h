@@ -0,0 +1,53 @@
+/*
+ * pca9745_pump.h
+ *
+ *  Created on: Jun 23, 2021
+ *      Author: THollis
+ */
+
+#ifndef INC_PCA9745_PCA9745_PUMP_H_
+#define INC_PCA9745_PCA9745_PUMP_H_
+
+#include "pca9745.h"
+
+#define PCA9745_PUMP_PAD		2		//nCS high byte slots after each frame
+#define PCA9745_PUMP_PAD_BYTE	0xFF	//shifted during the pad slots, ignored by the chain
+
+//Frame list layout: frame k starts at k * PCA9745_PUMP_STRIDE(num_dev), 2 * num_dev frame bytes
+//exactly as _PCA9745_Build_Frame lays them out, then PCA9745_PUMP_PAD pad bytes.
+#define PCA9745_PUMP_STRIDE(num_dev)	(2U * (num_dev) + PCA9745_PUMP_PAD)
+
+//Sends a list of chain frames with no CPU involvement between frames. The slot timer requests
+//one DMA transfer of the list into SPI DR per update event, one byte per slot. Its OC1REF, set
+//lead ticks before every update, is the TRGO clocking the nCS timer, whose output compare channel
+//is low for the 2 * num_dev frame slots and high for the pad slots. nCS changes lead ticks ahead
+//of the byte of the next slot, and a slot must be longer than lead + one byte + the DMA latency.
+typedef struct PCA9745_Pump {
+	PCA9745 *p;
+	uint8_t *list;					//frame list, see PCA9745_PUMP_STRIDE
+	uint32_t size;					//bytes available in list
+	uint32_t len;					//bytes captured
+	uint16_t frames;				//frames captured
+	uint8_t capture;				//1 - _PCA9745_Write appends to the list instead of sending
+
+	TIM_HandleTypeDef *htim_slot;	//byte slot timer, update requests the DMA, OC1REF is TRGO
+	TIM_HandleTypeDef *htim_cs;		//counts slots on the slot timer's TRGO, drives nCS
+	uint32_t cs_channel;			//TIM_CHANNEL_x of the nCS pin
+	DMA_HandleTypeDef hdma;			//update request of the slot timer, list to SPI DR
+
+	volatile uint8_t running;		//1 - a list is being sent
+	uint32_t runs;					//lists sent
+	uint32_t late;					//lists whose stop came after nCS had started another frame
+} PCA9745_Pump;
+
+void PCA9745_Pump_Init(PCA9745_Pump *u, PCA9745 *p, uint8_t *list, uint32_t size,
+		TIM_HandleTypeDef *htim_slot, uint32_t slot_ticks, uint32_t lead_ticks,
+		TIM_HandleTypeDef *htim_cs, uint32_t cs_trigger, uint32_t cs_channel, uint8_t cs_af,
+		DMA_Stream_TypeDef *stream, uint32_t dma_channel);
+void PCA9745_Pump_Begin(PCA9745_Pump *u);
+uint16_t PCA9745_Pump_Start(PCA9745_Pump *u);
+void PCA9745_Pump_Abort(PCA9745_Pump *u);
+void PCA9745_Pump_IRQHandler(PCA9745_Pump *u);
+uint8_t *_PCA9745_Pump_Next(PCA9745_Pump *u);
+
+#endif /* INC_PCA9745_PCA9745_PUMP_H_ */
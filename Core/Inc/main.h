@@ -54,6 +54,7 @@ extern "C" {
 void Error_Handler(void);
 
 /* USER CODE BEGIN EFP */
+void Render_Task(void);
 
 /* USER CODE END EFP */
 
@@ -70,6 +71,14 @@ void Error_Handler(void);
 #define nOE_GPIO_Port GPIOC
 #define nCS_Pin GPIO_PIN_5
 #define nCS_GPIO_Port GPIOC
+#define nOE1_Pin GPIO_PIN_8
+#define nOE1_GPIO_Port GPIOD
+#define nCS1_Pin GPIO_PIN_9
+#define nCS1_GPIO_Port GPIOD
+#define nOE2_Pin GPIO_PIN_10
+#define nOE2_GPIO_Port GPIOD
+#define nCS2_Pin GPIO_PIN_11
+#define nCS2_GPIO_Port GPIOD
 /* USER CODE BEGIN Private defines */
 
 /* USER CODE END Private defines */
@@ -26,6 +26,11 @@
 
 #include "PCA9745/pca9745.h"
 #include "LED_Tile/led_tile.h"
+#include "LED_Tile/led_tile_fx.h"
+#include "LED_Tile/led_tile_twinkle.h"
+#include "LED_Tile/led_tile_sweep.h"
+#include "LED_Tile/led_tile_comp.h"
+#include "LED_Tile/led_tile_map.h"
 #include "math.h"
 
 /* USER CODE END Includes */
@@ -37,6 +42,8 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+#define FX_PERIOD_MS	10000	//time each effect is shown for
+#define MASTER_STEP		32		//master brightness change per button press
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -48,12 +55,22 @@
 I2C_HandleTypeDef hi2c1;
 
 SPI_HandleTypeDef hspi1;
+DMA_HandleTypeDef hdma_spi1_rx;
+DMA_HandleTypeDef hdma_spi1_tx;
+SPI_HandleTypeDef hspi2;
+SPI_HandleTypeDef hspi3;
+DMA_HandleTypeDef hdma_spi2_rx;
+DMA_HandleTypeDef hdma_spi2_tx;
+DMA_HandleTypeDef hdma_spi3_rx;
+DMA_HandleTypeDef hdma_spi3_tx;
 
 TIM_HandleTypeDef htim1;
 
 /* USER CODE BEGIN PV */
 
 float intensity = 1.0f;
+volatile int16_t master = 255;			//master brightness, set by the buttons
+volatile uint8_t master_req = 0;		//applied by Render_Task
 LED_Tile tile;
 
 /* USER CODE END PV */
@@ -61,9 +78,12 @@ LED_Tile tile;
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_I2C1_Init(void);
 static void MX_SPI1_Init(void);
 static void MX_TIM1_Init(void);
+static void MX_SPI2_Init(void);
+static void MX_SPI3_Init(void);
 /* USER CODE BEGIN PFP */
 
 /* USER CODE END PFP */
@@ -101,21 +121,36 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_I2C1_Init();
   MX_SPI1_Init();
   MX_USB_DEVICE_Init();
   MX_TIM1_Init();
+  MX_SPI2_Init();
+  MX_SPI3_Init();
   /* USER CODE BEGIN 2 */
 
-  tile = Init_LED_Tile();
+  tile = Init_LED_Tile(NUM_TILES);
+  LED_Tile_Map_Grid(&tile, NUM_TILES);
 
-  for(uint8_t dev = 0; dev < NUM_TILES; dev++){
-	  for(uint16_t i = 0; i < 6; i++){
-		  LED_Tile_Set_LED_Intensity(&tile, dev, i, intensity);
-	  }
-  }
+  LED_Tile_Set_Intensity_All(&tile, intensity);
+  LED_Tile_Set_Master(&tile, master);
+
+  LED_Tile_Set_Dimmer(&tile, 0xFFFF);
+
+  LED_Tile_FX_Register(&LED_Tile_FX_Sweep);
+  LED_Tile_FX_Register(&LED_Tile_FX_Twinkle);
+  LED_Tile_FX_Register(&LED_Tile_FX_Layers);
+  LED_Tile_Layer_Set(0, &LED_Tile_FX_Sweep, TILE_BLEND_ALPHA, 64);
+  LED_Tile_Layer_Set(1, &LED_Tile_FX_Twinkle, TILE_BLEND_ADD, 255);
+  LED_Tile_Twinkle_Config(500, 10);
+  LED_Tile_Twinkle_Seed(LED_Tile_Rand_Hardware_Seed());
 
-  _PCA9745_OE(tile.p, 0);
+  uint8_t fx_id = 0;
+  uint32_t fx_tick = HAL_GetTick();
+  LED_Tile_FX_Select(&tile, fx_id);
+  LED_Tile_FX_Set_Policy(&tile, TILE_FX_DROP, 1);
+  LED_Tile_FX_Start(&tile, 100.0f);
 
   /* USER CODE END 2 */
 
@@ -123,13 +158,11 @@ int main(void)
   /* USER CODE BEGIN WHILE */
 
   while (1){
-	LED_Tile_Test_All(&tile);
-	LED_Tile_Clear_All(&tile);
-
-	LED_Tile_Twinkle_Init(&tile, 500, 10);
-	LED_Tile_Twinkle_Start(&tile, 100.0f);
-	HAL_Delay(10000);
-	LED_Tile_Twinkle_Stop(&tile);
+	if(HAL_GetTick() - fx_tick >= FX_PERIOD_MS){
+		fx_tick += FX_PERIOD_MS;
+		fx_id = (fx_id + 1) % LED_Tile_FX_Count();
+		LED_Tile_FX_Select(&tile, fx_id);
+	}
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
@@ -252,6 +285,82 @@ static void MX_SPI1_Init(void)
 
 }
 
+/**
+  * @brief SPI2 Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_SPI2_Init(void)
+{
+
+  /* USER CODE BEGIN SPI2_Init 0 */
+
+  /* USER CODE END SPI2_Init 0 */
+
+  /* USER CODE BEGIN SPI2_Init 1 */
+
+  /* USER CODE END SPI2_Init 1 */
+  /* SPI2 parameter configuration*/
+  hspi2.Instance = SPI2;
+  hspi2.Init.Mode = SPI_MODE_MASTER;
+  hspi2.Init.Direction = SPI_DIRECTION_2LINES;
+  hspi2.Init.DataSize = SPI_DATASIZE_8BIT;
+  hspi2.Init.CLKPolarity = SPI_POLARITY_LOW;
+  hspi2.Init.CLKPhase = SPI_PHASE_1EDGE;
+  hspi2.Init.NSS = SPI_NSS_SOFT;
+  hspi2.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_2;
+  hspi2.Init.FirstBit = SPI_FIRSTBIT_MSB;
+  hspi2.Init.TIMode = SPI_TIMODE_DISABLE;
+  hspi2.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+  hspi2.Init.CRCPolynomial = 10;
+  if (HAL_SPI_Init(&hspi2) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN SPI2_Init 2 */
+
+  /* USER CODE END SPI2_Init 2 */
+
+}
+
+/**
+  * @brief SPI3 Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_SPI3_Init(void)
+{
+
+  /* USER CODE BEGIN SPI3_Init 0 */
+
+  /* USER CODE END SPI3_Init 0 */
+
+  /* USER CODE BEGIN SPI3_Init 1 */
+
+  /* USER CODE END SPI3_Init 1 */
+  /* SPI3 parameter configuration*/
+  hspi3.Instance = SPI3;
+  hspi3.Init.Mode = SPI_MODE_MASTER;
+  hspi3.Init.Direction = SPI_DIRECTION_2LINES;
+  hspi3.Init.DataSize = SPI_DATASIZE_8BIT;
+  hspi3.Init.CLKPolarity = SPI_POLARITY_LOW;
+  hspi3.Init.CLKPhase = SPI_PHASE_1EDGE;
+  hspi3.Init.NSS = SPI_NSS_SOFT;
+  hspi3.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_2;
+  hspi3.Init.FirstBit = SPI_FIRSTBIT_MSB;
+  hspi3.Init.TIMode = SPI_TIMODE_DISABLE;
+  hspi3.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+  hspi3.Init.CRCPolynomial = 10;
+  if (HAL_SPI_Init(&hspi3) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN SPI3_Init 2 */
+
+  /* USER CODE END SPI3_Init 2 */
+
+}
+
 /**
   * @brief TIM1 Initialization Function
   * @param None
@@ -298,6 +407,38 @@ static void MX_TIM1_Init(void)
 
 }
 
+/**
+  * Enable DMA controller clock
+  */
+static void MX_DMA_Init(void)
+{
+
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  /* DMA1_Stream0_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+  /* DMA1_Stream3_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Stream3_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream3_IRQn);
+  /* DMA1_Stream4_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+  /* DMA1_Stream5_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+  /* DMA2_Stream0_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+  /* DMA2_Stream3_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA2_Stream3_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream3_IRQn);
+
+}
+
 /**
   * @brief GPIO Initialization Function
   * @param None
@@ -313,12 +454,22 @@ static void MX_GPIO_Init(void)
   __HAL_RCC_GPIOA_CLK_ENABLE();
   __HAL_RCC_GPIOC_CLK_ENABLE();
   __HAL_RCC_GPIOB_CLK_ENABLE();
+  __HAL_RCC_GPIOD_CLK_ENABLE();
 
   /*Configure GPIO pin Output Level */
   HAL_GPIO_WritePin(LED0_GPIO_Port, LED0_Pin, GPIO_PIN_RESET);
 
   /*Configure GPIO pin Output Level */
-  HAL_GPIO_WritePin(GPIOC, nOE_Pin|nCS_Pin, GPIO_PIN_RESET);
+  HAL_GPIO_WritePin(nOE_GPIO_Port, nOE_Pin, GPIO_PIN_SET);
+
+  /*Configure GPIO pin Output Level */
+  HAL_GPIO_WritePin(nCS_GPIO_Port, nCS_Pin, GPIO_PIN_RESET);
+
+  /*Configure GPIO pin Output Level */
+  HAL_GPIO_WritePin(GPIOD, nOE1_Pin|nOE2_Pin, GPIO_PIN_SET);
+
+  /*Configure GPIO pin Output Level */
+  HAL_GPIO_WritePin(GPIOD, nCS1_Pin|nCS2_Pin, GPIO_PIN_RESET);
 
   /*Configure GPIO pins : K1_Pin K0_Pin */
   GPIO_InitStruct.Pin = K1_Pin|K0_Pin;
@@ -347,11 +498,25 @@ static void MX_GPIO_Init(void)
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
   HAL_GPIO_Init(nCS_GPIO_Port, &GPIO_InitStruct);
 
+  /*Configure GPIO pins : nOE1_Pin nOE2_Pin */
+  GPIO_InitStruct.Pin = nOE1_Pin|nOE2_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+  HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
+
+  /*Configure GPIO pins : nCS1_Pin nCS2_Pin */
+  GPIO_InitStruct.Pin = nCS1_Pin|nCS2_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+  GPIO_InitStruct.Pull = GPIO_PULLUP;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+  HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
+
   /* EXTI interrupt init*/
-  HAL_NVIC_SetPriority(EXTI3_IRQn, 0, 0);
+  HAL_NVIC_SetPriority(EXTI3_IRQn, 1, 0);
   HAL_NVIC_EnableIRQ(EXTI3_IRQn);
 
-  HAL_NVIC_SetPriority(EXTI4_IRQn, 0, 0);
+  HAL_NVIC_SetPriority(EXTI4_IRQn, 1, 0);
   HAL_NVIC_EnableIRQ(EXTI4_IRQn);
 
 }
@@ -360,21 +525,43 @@ static void MX_GPIO_Init(void)
 
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin){
 	if(GPIO_Pin == K1_Pin){
-		intensity += 0.15f;
-
+		master = (master > 255 - MASTER_STEP) ? 255 : master + MASTER_STEP;
 	}
 	else if(GPIO_Pin == K0_Pin){
-		intensity -= 0.15f;
-	}
-	for(uint16_t i = 0; i < 6; i++){
-		LED_Tile_Set_LED_Intensity(&tile, 0, i, intensity);
+		master = (master < MASTER_STEP) ? 0 : master - MASTER_STEP;
 	}
+	master_req = 1;
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
 }
 
 void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim){
 	if(htim == &htim1){
-		LED_Tile_Twinkle_Update(&tile);
+		LED_Tile_FX_Tick(&tile);
+	}
+}
+
+/**
+  * @brief  Render Task
+  * @note	Called from PendSV_Handler at the lowest priority. Everything that writes to the tiles
+  * 		runs here, so the interrupts above only post requests and the bus has a single owner.
+  *
+  * @param  None
+  * @retval None
+  */
+void Render_Task(void){
+	if(master_req){
+		master_req = 0;
+		LED_Tile_Set_Master(&tile, master);
 	}
+	LED_Tile_FX_Update(&tile);
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi){
+	LED_Tile_SPI_Complete(&tile, hspi);
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi){
+	LED_Tile_SPI_Complete(&tile, hspi);
 }
 
 /* USER CODE END 4 */
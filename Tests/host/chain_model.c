@@ -0,0 +1,75 @@
+/*
+ * chain_model.c
+ *
+ *  Register level model of a PCA9745B daisy chain.
+ */
+
+#include "chain_model.h"
+
+void Chain_Model_Init(Chain_Model *m, uint16_t num_dev){
+	memset(m, 0, sizeof(*m));
+	m->num_dev = num_dev;
+}
+
+void Chain_Model_Shift(Chain_Model *m, uint8_t data){
+	if(m->bytes < sizeof(m->shift)){
+		m->shift[m->bytes] = data;
+	}
+	m->bytes++;
+}
+
+/**
+  * @brief  nCS Rising Edge
+  * @note	Device i executes the pair at frame offset 2 * i. Reads, the no-op and anything
+  * 		past OFFSET other than PWMALL/IREFALL leave the registers alone.
+  */
+void Chain_Model_Latch(Chain_Model *m){
+	m->latches++;
+	if(m->bytes != 2UL * m->num_dev){
+		m->bad_len++;
+		m->bytes = 0;
+		return;
+	}
+	for(uint16_t i = 0; i < m->num_dev; i++){
+		uint8_t instr = m->shift[2 * i];
+		uint8_t data = m->shift[2 * i + 1];
+		uint8_t reg = instr >> 1;
+		if(instr & 0x01){
+			continue;
+		}
+		if(reg < PCA9745_SHADOW_SIZE){
+			m->reg[i][reg] = data;
+		}
+		else if(reg == PWMALL){
+			memset(&m->reg[i][PWM0], data, 16);
+		}
+		else if(reg == IREFALL){
+			memset(&m->reg[i][IREF0], data, 16);
+		}
+	}
+	m->bytes = 0;
+}
+
+//Replay a recording of whole frames, as logged in SPI_HandleTypeDef.wire
+void Chain_Model_Replay(Chain_Model *m, const uint8_t *wire, uint32_t len){
+	for(uint32_t k = 0; k < len; k++){
+		Chain_Model_Shift(m, wire[k]);
+		if(m->bytes == 2UL * m->num_dev){
+			Chain_Model_Latch(m);
+		}
+	}
+}
+
+//Registers whose shadow is valid but holds something other than the device
+uint32_t Chain_Model_Check(Chain_Model *m, PCA9745 *p){
+	uint32_t bad = 0;
+	for(uint16_t dev = 0; dev < m->num_dev; dev++){
+		for(uint8_t reg = 0; reg < PCA9745_SHADOW_SIZE; reg++){
+			uint8_t data;
+			if(PCA9745_Get_Shadow(p, dev, reg, &data) && data != m->reg[dev][reg]){
+				bad++;
+			}
+		}
+	}
+	return bad;
+}
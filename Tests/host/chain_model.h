@@ -0,0 +1,28 @@
+/*
+ * chain_model.h
+ *
+ *  Register level model of a PCA9745B daisy chain: bytes shift in while nCS
+ *  is low and every device latches its instruction/data pair on the rising edge.
+ */
+
+#ifndef TESTS_HOST_CHAIN_MODEL_H_
+#define TESTS_HOST_CHAIN_MODEL_H_
+
+#include "PCA9745/pca9745.h"
+
+typedef struct {
+	uint16_t num_dev;
+	uint8_t reg[PCA9745_MAX_DEV][PCA9745_SHADOW_SIZE];	//device registers, MODE1 through OFFSET
+	uint8_t shift[2 * PCA9745_MAX_DEV];					//bytes shifted since nCS fell
+	uint32_t bytes;
+	uint32_t latches;
+	uint32_t bad_len;									//latches with other than 2 * num_dev bytes
+} Chain_Model;
+
+void Chain_Model_Init(Chain_Model *m, uint16_t num_dev);
+void Chain_Model_Shift(Chain_Model *m, uint8_t data);
+void Chain_Model_Latch(Chain_Model *m);
+void Chain_Model_Replay(Chain_Model *m, const uint8_t *wire, uint32_t len);
+uint32_t Chain_Model_Check(Chain_Model *m, PCA9745 *p);
+
+#endif /* TESTS_HOST_CHAIN_MODEL_H_ */
@@ -0,0 +1,142 @@
+/*
+ * hal_stub.c
+ *
+ *  Host stand-in for the HAL drivers and CMSIS core registers used by the
+ *  LED_Tile and PCA9745 drivers. Every SPI transfer is appended to the wire log
+ *  of its handle. DMA transfers complete through hal_spi_done, on the spot or,
+ *  with async set on the handle, once their bus time has passed on DWT->CYCCNT.
+ */
+
+#include "main.h"
+#include "PCA9745/pca9745_oe.h"
+
+#define HAL_CYCLES_PER_POLL	16		//cycle counter advance per DWT access
+#define HAL_CYCLES_PER_BYTE	128		//8 bits at SPI1 10.5 MHz from 168 MHz
+
+uint32_t hal_tick = 1000;
+uint32_t hal_basepri;
+uint32_t hal_apsr_ge;
+GPIO_TypeDef hal_gpioc, hal_gpiod;
+
+void (*hal_spi_done)(SPI_HandleTypeDef *h);
+uint32_t hal_dma_src, hal_dma_len;
+
+static DWT_Type dwt;
+static CoreDebug_Type core_debug;
+static SysTick_Type systick;
+static SCB_Type scb;
+CoreDebug_Type *CoreDebug = &core_debug;
+SysTick_Type *SysTick = &systick;
+SCB_Type *SCB = &scb;
+uint32_t SystemCoreClock = 168000000;
+
+static SPI_TypeDef spi1, spi2, spi3;
+static TIM_TypeDef tim1;
+SPI_HandleTypeDef hspi1 = {.Instance = &spi1, .cs_port = nCS_GPIO_Port, .cs_pin = nCS_Pin};
+SPI_HandleTypeDef hspi2 = {.Instance = &spi2, .cs_port = nCS1_GPIO_Port, .cs_pin = nCS1_Pin};
+SPI_HandleTypeDef hspi3 = {.Instance = &spi3, .cs_port = nCS2_GPIO_Port, .cs_pin = nCS2_Pin};
+TIM_HandleTypeDef htim1 = {.Instance = &tim1};
+
+static SPI_HandleTypeDef *const spi_handles[] = {&hspi1, &hspi2, &hspi3};
+
+DWT_Type *hal_dwt(void){
+	dwt.CYCCNT += HAL_CYCLES_PER_POLL;
+	for(uint8_t k = 0; k < sizeof(spi_handles) / sizeof(spi_handles[0]); k++){
+		SPI_HandleTypeDef *h = spi_handles[k];
+		if(h->dma_pending && !h->hang && (int32_t)(dwt.CYCCNT - h->dma_done_at) >= 0){
+			HAL_SPI_Run(h);
+		}
+	}
+	return &dwt;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *h, uint8_t *d, uint16_t n, uint32_t timeout){
+	(void)timeout;
+	if(h->wire_len + n <= sizeof(h->wire)){
+		memcpy(&h->wire[h->wire_len], d, n);
+		h->wire_len += n;
+	}
+	if(h->cs_port != NULL && (h->cs_port->ODR & h->cs_pin)){
+		h->cs_errors++;
+	}
+	h->frames++;
+	return HAL_OK;
+}
+
+void HAL_SPI_Clear_Log(SPI_HandleTypeDef *h){
+	h->wire_len = 0;
+	h->frames = 0;
+	h->cs_errors = 0;
+}
+
+//Finish the DMA transfer in flight, as its completion interrupt would
+void HAL_SPI_Run(SPI_HandleTypeDef *h){
+	if(!h->dma_pending){
+		return;
+	}
+	h->dma_pending = 0;
+	if(memcmp(h->dma_buf, h->dma_copy, h->dma_n) != 0){
+		h->dma_corrupt++;
+	}
+	if(hal_spi_done != NULL){
+		hal_spi_done(h);
+	}
+}
+
+static HAL_StatusTypeDef hal_spi_dma_start(SPI_HandleTypeDef *h, uint8_t *d, uint16_t n){
+	if(h->dma_pending){
+		h->dma_busy++;
+		return HAL_BUSY;
+	}
+	HAL_SPI_Transmit(h, d, n, 0);
+	h->dma_buf = d;
+	h->dma_n = (n < sizeof(h->dma_copy)) ? n : sizeof(h->dma_copy);
+	memcpy(h->dma_copy, d, h->dma_n);
+	h->dma_done_at = dwt.CYCCNT + n * HAL_CYCLES_PER_BYTE;
+	h->dma_pending = 1;
+	if(!h->async && !h->hang){
+		HAL_SPI_Run(h);
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *h, uint8_t *d, uint16_t n){
+	return hal_spi_dma_start(h, d, n);
+}
+
+//Reads return 0x00, the chain model does not drive SDO
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *h, uint8_t *d, uint16_t n, uint32_t timeout){
+	(void)h;
+	(void)timeout;
+	memset(d, 0, n);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *h, uint8_t *t, uint8_t *r, uint16_t n, uint32_t timeout){
+	(void)timeout;
+	memset(r, 0, n);
+	return HAL_SPI_Transmit(h, t, n, 0);
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *h, uint8_t *t, uint8_t *r, uint16_t n){
+	memset(r, 0, n);
+	return hal_spi_dma_start(h, t, n);
+}
+
+HAL_StatusTypeDef HAL_SPI_DMAStop(SPI_HandleTypeDef *h){
+	h->dma_pending = 0;
+	h->dma_stops++;
+	return HAL_OK;
+}
+
+//pca9745_oe.c drives timer registers the host does not have
+void PCA9745_OE_Set_Duty(PCA9745_OE_Timer *o, uint16_t duty){
+	(void)o;
+	(void)duty;
+}
+
+uint8_t PCA9745_OE_Strobe(PCA9745_OE_Timer *o, uint16_t width){
+	(void)o;
+	(void)width;
+	return 0;
+}
@@ -0,0 +1,241 @@
+/*
+ * main.h
+ *
+ *  Host stand-in for Core/Inc/main.h: just enough of the HAL, CMSIS and the
+ *  CubeMX pin names for the LED_Tile and PCA9745 drivers to build with gcc.
+ *  SPI transfers are logged per bus in the handle and complete immediately.
+ */
+
+#ifndef TESTS_HOST_MAIN_H_
+#define TESTS_HOST_MAIN_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define __IO volatile
+
+typedef enum { HAL_OK = 0, HAL_ERROR, HAL_BUSY } HAL_StatusTypeDef;
+#define RESET 0
+
+//Core
+typedef struct { volatile uint32_t CTRL, CYCCNT; } DWT_Type;
+typedef struct { volatile uint32_t DEMCR; } CoreDebug_Type;
+typedef struct { volatile uint32_t VAL; } SysTick_Type;
+typedef struct { volatile uint32_t ICSR; } SCB_Type;
+//Every access to DWT moves the cycle counter on and finishes the DMA transfers that are due,
+//so code spinning on CYCCNT or on a flag set from a completion callback makes progress
+DWT_Type *hal_dwt(void);
+#define DWT			(hal_dwt())
+extern CoreDebug_Type *CoreDebug;
+extern SysTick_Type *SysTick;
+extern SCB_Type *SCB;
+extern uint32_t SystemCoreClock;
+#define CoreDebug_DEMCR_TRCENA_Msk	1
+#define DWT_CTRL_CYCCNTENA_Msk		1
+#define SCB_ICSR_PENDSVSET_Msk		(1UL << 28)
+#define __NVIC_PRIO_BITS			4
+
+extern uint32_t hal_basepri;
+static inline uint32_t __get_BASEPRI(void){ return hal_basepri; }
+static inline void __set_BASEPRI(uint32_t v){ hal_basepri = v; }
+static inline uint32_t __get_PRIMASK(void){ return 0; }
+static inline void __set_PRIMASK(uint32_t m){ (void)m; }
+static inline void __disable_irq(void){}
+static inline void __DMB(void){}
+
+//Cortex-M4 SIMD intrinsics, for builds with -D__ARM_FEATURE_DSP=1. hal_apsr_ge holds the GE flags
+//__USUB8 sets and __SEL reads, one per byte lane.
+extern uint32_t hal_apsr_ge;
+static inline uint32_t __ROR(uint32_t v, uint32_t n){ n &= 31; return n ? (v >> n) | (v << (32 - n)) : v; }
+static inline uint32_t __UQADD8(uint32_t a, uint32_t b){
+	uint32_t r = 0;
+	for(uint8_t k = 0; k < 32; k += 8){
+		uint32_t v = ((a >> k) & 0xFF) + ((b >> k) & 0xFF);
+		r |= ((v > 0xFF) ? 0xFF : v) << k;
+	}
+	return r;
+}
+static inline uint32_t __USUB8(uint32_t a, uint32_t b){
+	uint32_t r = 0;
+	hal_apsr_ge = 0;
+	for(uint8_t k = 0; k < 4; k++){
+		uint32_t x = (a >> (k * 8)) & 0xFF, y = (b >> (k * 8)) & 0xFF;
+		hal_apsr_ge |= (x >= y) << k;
+		r |= ((x - y) & 0xFF) << (k * 8);
+	}
+	return r;
+}
+static inline uint32_t __SEL(uint32_t a, uint32_t b){
+	uint32_t r = 0;
+	for(uint8_t k = 0; k < 4; k++){
+		r |= (((hal_apsr_ge >> k) & 0x01) ? a : b) & (0xFFUL << (k * 8));
+	}
+	return r;
+}
+static inline uint32_t __UXTB16(uint32_t v){ return v & 0x00FF00FFUL; }
+
+//Time, hal_tick only moves when a test advances it
+extern uint32_t hal_tick;
+static inline uint32_t HAL_GetTick(void){ return hal_tick; }
+static inline void HAL_Delay(uint32_t d){ hal_tick += d; }
+
+//GPIO, a pin is its bit in ODR
+typedef struct {
+	volatile uint32_t MODER, ODR, AFR[2];
+	uint32_t rises[16];			//low to high writes per pin
+} GPIO_TypeDef;
+extern GPIO_TypeDef hal_gpioc, hal_gpiod;
+#define GPIOC		(&hal_gpioc)
+#define GPIOD		(&hal_gpiod)
+static inline void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, int state){
+	if(state){
+		for(uint8_t k = 0; k < 16; k++){
+			if((pin & ~port->ODR) & (1UL << k)){
+				port->rises[k]++;
+			}
+		}
+		port->ODR |= pin;
+	}
+	else{
+		port->ODR &= ~pin;
+	}
+}
+#define nOE_Pin			0x0010
+#define nOE_GPIO_Port	GPIOC
+#define nCS_Pin			0x0020
+#define nCS_GPIO_Port	GPIOC
+#define nOE1_Pin		0x0100
+#define nOE1_GPIO_Port	GPIOD
+#define nCS1_Pin		0x0200
+#define nCS1_GPIO_Port	GPIOD
+#define nOE2_Pin		0x0400
+#define nOE2_GPIO_Port	GPIOD
+#define nCS2_Pin		0x0800
+#define nCS2_GPIO_Port	GPIOD
+
+//SPI, each handle logs what was shifted out on its bus
+typedef struct { volatile uint32_t CR1, SR, DR; } SPI_TypeDef;
+typedef struct { uint32_t BaudRatePrescaler; } SPI_InitTypeDef;
+typedef struct {
+	SPI_TypeDef *Instance;
+	SPI_InitTypeDef Init;
+
+	GPIO_TypeDef *cs_port;		//nCS of the chain on this bus
+	uint16_t cs_pin;
+	uint8_t wire[1 << 18];		//bytes shifted out, appended per transfer
+	uint32_t wire_len;
+	uint32_t frames;			//transfers
+	uint32_t cs_errors;			//transfers started with nCS high
+
+	uint8_t async;				//1 - DMA transfers finish after their bus time, 0 - on the spot
+	uint8_t hang;				//1 - DMA transfers never finish
+	uint8_t dma_pending;		//a DMA transfer is in flight
+	uint32_t dma_done_at;		//cycle count it finishes at
+	const uint8_t *dma_buf;		//its source, and a copy taken when it started
+	uint8_t dma_copy[1024];
+	uint16_t dma_n;
+	uint32_t dma_corrupt;		//transfers whose source changed while in flight
+	uint32_t dma_busy;			//DMA starts refused, a transfer was still in flight
+	uint32_t dma_stops;			//HAL_SPI_DMAStop calls
+} SPI_HandleTypeDef;
+#define SPI_CR1_SPE		1
+#define SPI_SR_RXNE		1
+#define SPI_SR_TXE		2
+#define SPI_SR_BSY		0x80
+#define SPI_FLAG_TXE	SPI_SR_TXE
+#define SPI_FLAG_BSY	SPI_SR_BSY
+#define __HAL_SPI_GET_FLAG(h, f)	(((h)->Instance->SR & (f)) == (f))
+#define __HAL_SPI_CLEAR_OVRFLAG(h)	((void)(h))
+#define __HAL_SPI_ENABLE(h)			((h)->Instance->CR1 |= 0x40)
+extern void (*hal_spi_done)(SPI_HandleTypeDef *h);
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *h, uint8_t *d, uint16_t n, uint32_t timeout);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *h, uint8_t *d, uint16_t n);
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *h, uint8_t *d, uint16_t n, uint32_t timeout);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *h, uint8_t *t, uint8_t *r, uint16_t n, uint32_t timeout);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *h, uint8_t *t, uint8_t *r, uint16_t n);
+HAL_StatusTypeDef HAL_SPI_DMAStop(SPI_HandleTypeDef *h);
+void HAL_SPI_Clear_Log(SPI_HandleTypeDef *h);
+void HAL_SPI_Run(SPI_HandleTypeDef *h);
+
+//TIM
+typedef struct { volatile uint32_t PSC, ARR, CNT, CCR1, CCR2, CCR3, CCR4, SR, DIER, CR1, EGR, CCMR1, CCMR2, SMCR; } TIM_TypeDef;
+typedef struct { uint32_t Prescaler, CounterMode, Period, ClockDivision, RepetitionCounter, AutoReloadPreload; } TIM_Base_InitTypeDef;
+typedef struct { TIM_TypeDef *Instance; TIM_Base_InitTypeDef Init; } TIM_HandleTypeDef;
+typedef struct { uint32_t OCMode, Pulse, OCPolarity, OCFastMode, OCIdleState; } TIM_OC_InitTypeDef;
+typedef struct { uint32_t SlaveMode, InputTrigger; } TIM_SlaveConfigTypeDef;
+typedef struct { uint32_t MasterOutputTrigger, MasterSlaveMode; } TIM_MasterConfigTypeDef;
+#define TIM_CHANNEL_1					0x0
+#define TIM_CHANNEL_2					0x4
+#define TIM_CHANNEL_3					0x8
+#define TIM_CHANNEL_4					0xC
+#define TIM_CR1_CEN						1
+#define TIM_CR1_OPM						8
+#define TIM_CR1_ARPE					0x80
+#define TIM_EGR_UG						1
+#define TIM_FLAG_UPDATE					1
+#define TIM_IT_UPDATE					1
+#define TIM_DMA_UPDATE					0x100
+#define TIM_CCMR1_OC1PE					0x8
+#define TIM_CCMR2_OC3PE					0x8
+#define TIM_COUNTERMODE_UP				0
+#define TIM_CLOCKDIVISION_DIV1			0
+#define TIM_AUTORELOAD_PRELOAD_DISABLE	0
+#define TIM_AUTORELOAD_PRELOAD_ENABLE	0x80
+#define TIM_OCMODE_PWM1					0x60
+#define TIM_OCMODE_PWM2					0x70
+#define TIM_OCPOLARITY_HIGH				0
+#define TIM_OCPOLARITY_LOW				2
+#define TIM_OCFAST_DISABLE				0
+#define TIM_TRGO_OC1REF					0x40
+#define TIM_MASTERSLAVEMODE_DISABLE		0
+#define TIM_SLAVEMODE_EXTERNAL1			7
+#define TIM_TS_ITR1						0x10
+#define __HAL_TIM_CLEAR_FLAG(h, f)		((h)->Instance->SR = ~(f))
+#define __HAL_TIM_ENABLE_IT(h, f)		((h)->Instance->DIER |= (f))
+#define __HAL_TIM_DISABLE_IT(h, f)		((h)->Instance->DIER &= ~(f))
+#define __HAL_TIM_ENABLE_DMA(h, d)		((h)->Instance->DIER |= (d))
+#define __HAL_TIM_DISABLE_DMA(h, d)		((h)->Instance->DIER &= ~(d))
+#define __HAL_TIM_SET_COMPARE(h, c, v)	(*(&(h)->Instance->CCR1 + ((c) >> 2)) = (v))
+static inline HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *h){ (void)h; return HAL_OK; }
+static inline HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *h){ (void)h; return HAL_OK; }
+static inline HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *h){ h->Instance->ARR = h->Init.Period; return HAL_OK; }
+static inline HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *h, TIM_OC_InitTypeDef *c, uint32_t ch){
+	*(&h->Instance->CCR1 + (ch >> 2)) = c->Pulse;
+	if(ch == TIM_CHANNEL_1){
+		h->Instance->CCMR1 = c->OCMode | TIM_CCMR1_OC1PE;
+	}
+	return HAL_OK;
+}
+static inline HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *h, TIM_MasterConfigTypeDef *m){ (void)h; (void)m; return HAL_OK; }
+static inline HAL_StatusTypeDef HAL_TIM_SlaveConfigSynchro(TIM_HandleTypeDef *h, TIM_SlaveConfigTypeDef *s){ h->Instance->SMCR = s->SlaveMode | s->InputTrigger; return HAL_OK; }
+static inline HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *h, uint32_t ch){ (void)ch; h->Instance->CR1 |= TIM_CR1_CEN; return HAL_OK; }
+
+//DMA, HAL_DMA_Start_IT only records the source and length for the test to replay
+typedef struct { volatile uint32_t NDTR; } DMA_Stream_TypeDef;
+typedef struct { uint32_t Channel, Direction, PeriphInc, MemInc, PeriphDataAlignment, MemDataAlignment, Mode, Priority, FIFOMode; } DMA_InitTypeDef;
+typedef struct { DMA_Stream_TypeDef *Instance; DMA_InitTypeDef Init; void *Parent; } DMA_HandleTypeDef;
+#define DMA_MEMORY_TO_PERIPH	0
+#define DMA_PINC_DISABLE		0
+#define DMA_MINC_ENABLE			0
+#define DMA_PDATAALIGN_BYTE		0
+#define DMA_MDATAALIGN_BYTE		0
+#define DMA_NORMAL				0
+#define DMA_PRIORITY_HIGH		0
+#define DMA_FIFOMODE_DISABLE	0
+#define __HAL_DMA_GET_COUNTER(h)	((h)->Instance->NDTR)
+extern uint32_t hal_dma_src, hal_dma_len;
+static inline HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *h){ (void)h; return HAL_OK; }
+static inline HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *h, uint32_t src, uint32_t dst, uint32_t n){
+	(void)dst;
+	hal_dma_src = src;
+	hal_dma_len = n;
+	h->Instance->NDTR = n;
+	return HAL_OK;
+}
+static inline HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *h){ (void)h; return HAL_OK; }
+static inline void HAL_DMA_IRQHandler(DMA_HandleTypeDef *h){ (void)h; }
+
+#endif /* TESTS_HOST_MAIN_H_ */
@@ -0,0 +1,95 @@
+/*
+ * test_color_all.c
+ *
+ *  LED_Tile_Set_LED_Color_All with a grey may use PWMALL, which also sets the IR
+ *  channel. The IR LED is the camera tracking channel and must not change on any
+ *  latched frame, whatever level it holds.
+ */
+
+#include "main.h"
+#include "LED_Tile/led_tile.h"
+#include "chain_model.h"
+
+#define TILES	4
+
+LED_Tile tile;
+static Chain_Model model;
+static int fail;
+
+static void spi_done(SPI_HandleTypeDef *h){
+	LED_Tile_SPI_Complete(&tile, h);
+}
+
+static void replay(void){
+	Chain_Model_Replay(&model, hspi1.wire, hspi1.wire_len);
+	HAL_SPI_Clear_Log(&hspi1);
+}
+
+//Latch the logged frames one by one, the IR register of every device must hold ir[]
+static void replay_check(const uint8_t *ir, const char *what){
+	uint32_t frame = 2UL * model.num_dev;
+	for(uint32_t k = 0; k + frame <= hspi1.wire_len; k += frame){
+		Chain_Model_Replay(&model, &hspi1.wire[k], frame);
+		for(uint16_t dev = 0; dev < model.num_dev; dev++){
+			if(model.reg[dev][PWM15 - TILE_IR_CH] != ir[dev]){
+				printf("FAIL: %s, frame %lu sets IR of device %u to %02X, expected %02X\n", what,
+						(unsigned long)(k / frame), dev, model.reg[dev][PWM15 - TILE_IR_CH], ir[dev]);
+				fail = 1;
+			}
+		}
+	}
+	HAL_SPI_Clear_Log(&hspi1);
+}
+
+static void expect_rgb(uint8_t r, uint8_t g, uint8_t b, const char *what){
+	for(uint16_t dev = 0; dev < model.num_dev; dev++){
+		for(uint8_t led = 0; led < TILE_NUM_LEDS; led++){
+			if(model.reg[dev][PWM15 - TILE_LED_CH(led, TILE_RED)] != r ||
+					model.reg[dev][PWM15 - TILE_LED_CH(led, TILE_GREEN)] != g ||
+					model.reg[dev][PWM15 - TILE_LED_CH(led, TILE_BLUE)] != b){
+				printf("FAIL: %s, device %u LED %u is not %02X %02X %02X\n", what, dev, led, r, g, b);
+				fail = 1;
+			}
+		}
+	}
+}
+
+int main(void){
+	uint8_t ir[TILES] = {0};
+	hal_spi_done = spi_done;
+	tile = Init_LED_Tile(TILES);
+	Chain_Model_Init(&model, tile.p->num_dev);
+	LED_Tile_Clear_All(&tile);
+	replay();
+
+	//IR on at different levels, the grey must leave every one of them alone
+	for(uint16_t dev = 0; dev < TILES; dev++){
+		ir[dev] = 0x20 * (dev + 1);
+		LED_Tile_Set_IR_LED(&tile, dev, ir[dev]);
+	}
+	replay();
+	LED_Tile_Set_LED_Color_All(&tile, 0x80, 0x80, 0x80);
+	replay_check(ir, "grey over mixed IR");
+	expect_rgb(0x80, 0x80, 0x80, "grey over mixed IR");
+
+	//IR of two tiles at the grey level, those may take the broadcast
+	LED_Tile_Set_IR_LED(&tile, 0, 0x40);
+	LED_Tile_Set_IR_LED(&tile, 2, 0x40);
+	ir[0] = ir[2] = 0x40;
+	replay();
+	LED_Tile_Set_LED_Color_All(&tile, 0x40, 0x40, 0x40);
+	replay_check(ir, "grey over IR at grey");
+	expect_rgb(0x40, 0x40, 0x40, "grey over IR at grey");
+
+	LED_Tile_Set_LED_Color_All(&tile, 0x10, 0x20, 0x30);
+	replay_check(ir, "colour");
+	expect_rgb(0x10, 0x20, 0x30, "colour");
+
+	uint32_t bad = Chain_Model_Check(&model, tile.p);
+	if(bad || model.bad_len){
+		printf("FAIL: %lu shadow registers differ from the chain, %lu short frames\n", (unsigned long)bad, (unsigned long)model.bad_len);
+		fail = 1;
+	}
+	printf("%s: test_color_all\n", fail ? "FAIL" : "PASS");
+	return fail;
+}
@@ -0,0 +1,68 @@
+/*
+ * test_comp_blend.c
+ *
+ *  LED_Tile_Comp_Blend_Scalar is the reference of every blend mode, and the packed
+ *  kernels of LED_Tile_Comp_Blend have to match it bit for bit. Built with
+ *  __ARM_FEATURE_DSP so the packed kernels run on the intrinsics of host/main.h.
+ */
+
+#include "main.h"
+#include "LED_Tile/led_tile.h"
+#include "LED_Tile/led_tile_comp.h"
+
+#define WORDS	(0x10000 / 4)		//every dst/src byte pair once
+
+static uint32_t dst[WORDS], src[WORDS], scalar[WORDS], packed[WORDS];
+static int fail;
+
+//Expected channel from the mode's formula, alpha 255 copies the layer and 0 keeps dst
+static uint8_t expected(uint8_t d, uint8_t s, LED_Tile_Blend mode, uint8_t alpha){
+	switch(mode){
+	case TILE_BLEND_ADD:
+		return (d + s > 0xFF) ? 0xFF : d + s;
+	case TILE_BLEND_MAX:
+		return (s > d) ? s : d;
+	default:
+		if(alpha == 0){
+			return d;
+		}
+		if(alpha == 255){
+			return s;
+		}
+		return (d * (256 - (alpha + (alpha >> 7))) + s * (alpha + (alpha >> 7))) >> 8;
+	}
+}
+
+static void check(LED_Tile_Blend mode, uint8_t alpha){
+	memcpy(scalar, dst, sizeof(dst));
+	memcpy(packed, dst, sizeof(dst));
+	LED_Tile_Comp_Blend_Scalar(scalar, src, WORDS, mode, alpha);
+	LED_Tile_Comp_Blend(packed, src, WORDS, mode, alpha);
+	const uint8_t *d = (const uint8_t *)dst, *s = (const uint8_t *)src, *r = (const uint8_t *)scalar;
+	for(uint32_t i = 0; i < WORDS * 4; i++){
+		if(r[i] != expected(d[i], s[i], mode, alpha)){
+			printf("FAIL: scalar mode %u alpha %u, %02X over %02X gives %02X, expected %02X\n",
+					mode, alpha, s[i], d[i], r[i], expected(d[i], s[i], mode, alpha));
+			fail = 1;
+			return;
+		}
+	}
+	if(memcmp(scalar, packed, sizeof(scalar)) != 0){
+		printf("FAIL: packed mode %u alpha %u differs from scalar\n", mode, alpha);
+		fail = 1;
+	}
+}
+
+int main(void){
+	for(uint32_t i = 0; i < WORDS * 4; i++){
+		((uint8_t *)dst)[i] = i & 0xFF;
+		((uint8_t *)src)[i] = i >> 8;
+	}
+	check(TILE_BLEND_ADD, 0);
+	check(TILE_BLEND_MAX, 0);
+	for(uint16_t alpha = 0; alpha <= 255; alpha++){
+		check(TILE_BLEND_ALPHA, alpha);
+	}
+	printf("%s: test_comp_blend\n", fail ? "FAIL" : "PASS");
+	return fail;
+}
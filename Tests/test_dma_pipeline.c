@@ -0,0 +1,96 @@
+/*
+ * test_dma_pipeline.c
+ *
+ *  The DMA write path against a bus whose transfers finish asynchronously, after
+ *  their bit time. A write returns with its frame in flight and nCS low, the next
+ *  frame is built into the other half of the double buffer without touching the
+ *  one being sent, _PCA9745_TxCplt releases nCS and busy, and a transfer that
+ *  never finishes is aborted after PCA9745_XFR_DELAY.
+ */
+
+#include "main.h"
+#include "PCA9745/pca9745.h"
+
+#define NUM_DEV		8
+#define CS_BIT		5		//nCS_Pin
+
+extern SPI_HandleTypeDef hspi1;
+static PCA9745_Arena arena;
+static PCA9745 p;
+static int fail;
+
+static void spi_done(SPI_HandleTypeDef *h){
+	_PCA9745_TxCplt(&p, h);
+}
+
+static void expect(int ok, const char *what){
+	if(!ok){
+		printf("FAIL: %s\n", what);
+		fail = 1;
+	}
+}
+
+static void write_frame(uint8_t reg, uint8_t data){
+	for(uint16_t i = 0; i < NUM_DEV; i++){
+		p.instr_buffer[i] = reg;
+		p.data_buffer[i] = data + i;
+	}
+	_PCA9745_Write(&p, p.instr_buffer, p.data_buffer);
+}
+
+int main(void){
+	p = Init_PCA9745(&hspi1, nCS_GPIO_Port, nCS_Pin, nOE_GPIO_Port, nOE_Pin);
+	_PCA9745_Configure(&p, 1000, NUM_DEV, &arena);
+	_PCA9745_Set_DMA(&p, 1);
+	hal_spi_done = spi_done;
+	hspi1.async = 1;
+
+	//One frame: the write returns while it is still shifting
+	uint32_t rises = nCS_GPIO_Port->rises[CS_BIT];
+	write_frame(PWM0, 0x10);
+	expect(p.busy == 1 && hspi1.dma_pending, "write waited for its own frame");
+	expect(!(nCS_GPIO_Port->ODR & nCS_Pin), "nCS high while the frame is in flight");
+	expect(p.frame_index == 1, "frame buffer did not flip");
+	HAL_SPI_Run(&hspi1);
+	expect(p.busy == 0, "busy still set after TX complete");
+	expect((nCS_GPIO_Port->ODR & nCS_Pin) && nCS_GPIO_Port->rises[CS_BIT] == rises + 1, "nCS not released by TX complete");
+
+	//Back to back frames: each is built in the idle half, waits for the one in flight,
+	//then starts with nCS low after the previous frame was latched
+	HAL_SPI_Clear_Log(&hspi1);
+	rises = nCS_GPIO_Port->rises[CS_BIT];
+	for(uint8_t k = 0; k < 6; k++){
+		uint8_t half = p.frame_index;
+		write_frame(PWM1 + k, 0x20 * k);
+		expect(p.frame_index == (half ^ 1), "frame buffer did not flip");
+		expect(hspi1.dma_buf == arena.frame_buffer + half * 2 * NUM_DEV, "frame not sent from the idle half");
+		expect(nCS_GPIO_Port->rises[CS_BIT] == rises + k, "previous frame not latched before the next started");
+	}
+	_PCA9745_Wait(&p);
+	expect(hspi1.frames == 6 && hspi1.wire_len == 6 * 2 * NUM_DEV, "frames lost");
+	expect(hspi1.dma_corrupt == 0, "a frame buffer changed while its DMA was running");
+	expect(hspi1.dma_busy == 0, "a DMA was started over one in flight");
+	expect(hspi1.cs_errors == 0, "a frame started with nCS high");
+	for(uint8_t k = 0; k < 6; k++){
+		expect(hspi1.wire[k * 2 * NUM_DEV] == (PWM1 + k) << 1 && hspi1.wire[k * 2 * NUM_DEV + 3] == 0x20 * k + 1, "frames out of order");
+	}
+
+	//A read drains the pipeline before it reuses the frame buffer
+	HAL_SPI_Clear_Log(&hspi1);
+	write_frame(PWM0, 0x40);
+	_PCA9745_Read_Frame(&p, MODE2);
+	expect(hspi1.frames == 2 && hspi1.dma_corrupt == 0 && hspi1.dma_busy == 0, "read overlapped a write");
+	expect(p.busy == 0 && (nCS_GPIO_Port->ODR & nCS_Pin), "read returned with the bus busy");
+
+	//A transfer that never completes is stopped after PCA9745_XFR_DELAY
+	hspi1.hang = 1;
+	write_frame(PWM0, 0x50);
+	uint32_t start = DWT->CYCCNT;
+	_PCA9745_Wait(&p);
+	uint32_t waited = DWT->CYCCNT - start;
+	expect(p.busy == 0 && hspi1.dma_stops == 1 && (nCS_GPIO_Port->ODR & nCS_Pin), "hung transfer not aborted");
+	expect(waited >= SystemCoreClock / 1000 * PCA9745_XFR_DELAY, "hung transfer aborted early");
+
+	printf("%s: test_dma_pipeline\n", fail ? "FAIL" : "PASS");
+	return fail;
+}
@@ -0,0 +1,68 @@
+/*
+ * test_frame_order.c
+ *
+ *  _PCA9745_Write shifts a whole chain frame in one SPI transfer with nCS low,
+ *  device i at bytes 2i (instruction, write bit clear) and 2i + 1 (data). Checked
+ *  for 1, 2 and 64 devices, blocking and through the DMA double buffer.
+ */
+
+#include "main.h"
+#include "PCA9745/pca9745.h"
+
+extern SPI_HandleTypeDef hspi1;
+static PCA9745_Arena arena;
+static PCA9745 p;
+
+static void spi_done(SPI_HandleTypeDef *h){
+	_PCA9745_TxCplt(&p, h);
+}
+
+static int check(uint16_t num_dev, uint8_t dma){
+	int fail = 0;
+	p = Init_PCA9745(&hspi1, nCS_GPIO_Port, nCS_Pin, nOE_GPIO_Port, nOE_Pin);
+	_PCA9745_Configure(&p, 1000, num_dev, &arena);
+	_PCA9745_Set_DMA(&p, dma);
+	hal_spi_done = spi_done;
+
+	for(uint8_t round = 0; round < 3; round++){
+		for(uint16_t i = 0; i < num_dev; i++){
+			p.instr_buffer[i] = (i + round) % 0x40;
+			p.data_buffer[i] = (uint8_t)(i * 7 + round);
+		}
+		HAL_SPI_Clear_Log(&hspi1);
+		_PCA9745_Write(&p, p.instr_buffer, p.data_buffer);
+
+		if(hspi1.frames != 1 || hspi1.wire_len != 2UL * num_dev){
+			printf("FAIL: %u devices, %s: %lu transfers of %lu bytes in total\n", num_dev, dma ? "DMA" : "blocking",
+					(unsigned long)hspi1.frames, (unsigned long)hspi1.wire_len);
+			fail = 1;
+			continue;
+		}
+		if(hspi1.cs_errors || !(nCS_GPIO_Port->ODR & nCS_Pin)){
+			printf("FAIL: %u devices, %s: nCS low outside the frame\n", num_dev, dma ? "DMA" : "blocking");
+			fail = 1;
+		}
+		for(uint16_t i = 0; i < num_dev; i++){
+			uint8_t instr = ((i + round) % 0x40) << 1;
+			uint8_t data = (uint8_t)(i * 7 + round);
+			if(hspi1.wire[2 * i] != instr || hspi1.wire[2 * i + 1] != data){
+				printf("FAIL: %u devices, %s: device %u got %02X %02X, expected %02X %02X\n", num_dev, dma ? "DMA" : "blocking",
+						i, hspi1.wire[2 * i], hspi1.wire[2 * i + 1], instr, data);
+				fail = 1;
+				break;
+			}
+		}
+	}
+	return fail;
+}
+
+int main(void){
+	const uint16_t lengths[] = {1, 2, 64};
+	int fail = 0;
+	for(uint8_t k = 0; k < sizeof(lengths) / sizeof(lengths[0]); k++){
+		fail |= check(lengths[k], 0);
+		fail |= check(lengths[k], 1);
+	}
+	printf("%s: test_frame_order\n", fail ? "FAIL" : "PASS");
+	return fail;
+}
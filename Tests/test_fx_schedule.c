@@ -0,0 +1,108 @@
+/*
+ * test_fx_schedule.c
+ *
+ *  Frame scheduler. Under TILE_FX_DROP late ticks are merged into the next frame
+ *  and the effect is given the real time, so a twinkle field rendered every fourth
+ *  tick ends where one rendered on every tick does. TILE_FX_STRETCH keeps the
+ *  nominal step instead. With adaptation a heavy load lengthens the update period,
+ *  and it returns to the requested one when the load goes away.
+ */
+
+#include "main.h"
+#include "LED_Tile/led_tile.h"
+#include "LED_Tile/led_tile_fx.h"
+#include "LED_Tile/led_tile_twinkle.h"
+
+#define TILES	20
+
+LED_Tile tile;
+static LED_Tile_Twinkle *twinkle;
+static LED_Tile_Twinkle start_state;
+static LED_Tile_Pixels start_fb[TILES], ref_fb[TILES];
+static int fail;
+
+static void spi_done(SPI_HandleTypeDef *h){
+	LED_Tile_SPI_Complete(&tile, h);
+}
+
+//Run frames, each after the given number of update timer ticks
+static void frames(uint16_t n, uint8_t ticks){
+	while(n-- > 0){
+		for(uint8_t k = 0; k < ticks; k++){
+			LED_Tile_FX_Tick(&tile);
+		}
+		LED_Tile_FX_Update(&tile);
+	}
+}
+
+static void restore(void){
+	*twinkle = start_state;
+	memcpy(tile.fb, start_fb, sizeof(start_fb));
+}
+
+static void expect_fb(const LED_Tile_Pixels *fb, const char *what){
+	if(memcmp(tile.fb, fb, sizeof(start_fb)) != 0){
+		printf("FAIL: %s\n", what);
+		fail = 1;
+	}
+}
+
+int main(void){
+	hal_spi_done = spi_done;
+	tile = Init_LED_Tile(TILES);
+	twinkle = LED_Tile_FX_Twinkle.state;
+	LED_Tile_FX_Register(&LED_Tile_FX_Twinkle);
+	LED_Tile_Twinkle_Config(3 * TWINKLE_CHANCE, 50);
+	LED_Tile_FX_Select(&tile, 0);
+	LED_Tile_FX_Set_Policy(&tile, TILE_FX_DROP, 0);
+	LED_Tile_FX_Start(&tile, 100.0f);
+	if(tile.update_timer.period_us != 10000 || htim1.Instance->ARR != 9999 || htim1.Instance->PSC != TILE_TIM_MHZ - 1){
+		printf("FAIL: 100 Hz gives a period of %lu us, ARR %lu\n", (unsigned long)tile.update_timer.period_us, (unsigned long)htim1.Instance->ARR);
+		fail = 1;
+	}
+
+	//A field of twinkles that only decays from here on
+	frames(1, 1);
+	twinkle->chance = 0;
+	if(twinkle->num_active == 0){
+		printf("FAIL: no twinkles to follow\n");
+		fail = 1;
+	}
+	start_state = *twinkle;
+	memcpy(start_fb, tile.fb, sizeof(start_fb));
+
+	frames(40, 1);
+	memcpy(ref_fb, tile.fb, sizeof(ref_fb));
+	restore();
+	uint32_t dropped = tile.fx.dropped;
+	frames(10, 4);
+	expect_fb(ref_fb, "10 frames of 4 ticks differ from 40 frames of 1 tick under TILE_FX_DROP");
+	if(tile.fx.dropped - dropped != 30){
+		printf("FAIL: %lu ticks merged, expected 30\n", (unsigned long)(tile.fx.dropped - dropped));
+		fail = 1;
+	}
+
+	restore();
+	frames(10, 1);
+	memcpy(ref_fb, tile.fb, sizeof(ref_fb));
+	restore();
+	LED_Tile_FX_Set_Policy(&tile, TILE_FX_STRETCH, 0);
+	frames(10, 4);
+	expect_fb(ref_fb, "10 frames of 4 ticks differ from 10 frames of 1 tick under TILE_FX_STRETCH");
+
+	//30 ms frames at 100 Hz
+	LED_Tile_FX_Set_Policy(&tile, TILE_FX_DROP, 1);
+	tile.fx.load_cycles = 30000 * (SystemCoreClock / 1000000);
+	frames(1, 1);
+	if(tile.update_timer.period_us < 30000){
+		printf("FAIL: period %lu us under a 30 ms load\n", (unsigned long)tile.update_timer.period_us);
+		fail = 1;
+	}
+	frames(200, 1);
+	if(tile.update_timer.period_us != 10000){
+		printf("FAIL: period %lu us once the load is gone, requested 10000\n", (unsigned long)tile.update_timer.period_us);
+		fail = 1;
+	}
+	printf("%s: test_fx_schedule\n", fail ? "FAIL" : "PASS");
+	return fail;
+}
@@ -0,0 +1,127 @@
+/*
+ * test_fx_switch.c
+ *
+ *  Effects render through the frame pipeline. A switch selected while the timer
+ *  runs is taken on the next frame: the old effect is torn down and the new one
+ *  renders that same frame. Stopping tears down the active effect and commits a
+ *  dark framebuffer.
+ */
+
+#include "main.h"
+#include "LED_Tile/led_tile.h"
+#include "LED_Tile/led_tile_fx.h"
+#include "LED_Tile/led_tile_sweep.h"
+#include "LED_Tile/led_tile_twinkle.h"
+#include "chain_model.h"
+
+#define TILES		10
+#define RAMP_US		(255UL * 1000000UL / SWEEP_RATE)	//one sweep colour ramp
+
+LED_Tile tile;
+static Chain_Model model;
+static int fail;
+
+static void spi_done(SPI_HandleTypeDef *h){
+	LED_Tile_SPI_Complete(&tile, h);
+}
+
+static void frame(void){
+	LED_Tile_FX_Tick(&tile);
+	LED_Tile_FX_Update(&tile);
+}
+
+static uint32_t lit_channels(void){
+	uint32_t lit = 0;
+	for(uint16_t dev = 0; dev < TILES; dev++){
+		for(uint8_t ch = 0; ch < 15; ch++){
+			lit += (tile.fb[dev].ch[ch] != 0);
+		}
+	}
+	return lit;
+}
+
+//Every RGB channel of every tile holds the sweep at t_us since it started
+static void expect_sweep(uint32_t t_us, const char *what){
+	uint8_t level = (t_us % RAMP_US) * 255 / RAMP_US;
+	uint8_t ramp = t_us / RAMP_US;
+	for(uint16_t dev = 0; dev < TILES; dev++){
+		for(uint8_t led = 0; led < TILE_NUM_LEDS; led++){
+			for(uint8_t color = 0; color < 3; color++){
+				uint8_t v = tile.fb[dev].ch[TILE_LED_CH(led, color)];
+				if(v != ((ramp == color) ? level : 0)){
+					printf("FAIL: %s, tile %u LED %u colour %u is %u\n", what, dev, led, color, v);
+					fail = 1;
+					return;
+				}
+			}
+		}
+	}
+}
+
+//The chains hold what was committed
+static void expect_chain(const char *what){
+	Chain_Model_Replay(&model, hspi1.wire, hspi1.wire_len);
+	HAL_SPI_Clear_Log(&hspi1);
+	uint32_t bad = Chain_Model_Check(&model, tile.p);
+	for(uint16_t dev = 0; dev < TILES; dev++){
+		for(uint8_t ch = 0; ch < 16; ch++){
+			bad += (model.reg[dev][PWM15 - ch] != tile.fb[dev].ch[ch]);
+		}
+	}
+	if(bad){
+		printf("FAIL: %s, %lu registers differ from the framebuffer\n", what, (unsigned long)bad);
+		fail = 1;
+	}
+}
+
+int main(void){
+	hal_spi_done = spi_done;
+	tile = Init_LED_Tile(TILES);
+	Chain_Model_Init(&model, tile.p->num_dev);
+	uint8_t sweep_id = LED_Tile_FX_Register(&LED_Tile_FX_Sweep);
+	uint8_t twinkle_id = LED_Tile_FX_Register(&LED_Tile_FX_Twinkle);
+	LED_Tile_Twinkle_Config(5000, 20);
+	LED_Tile_FX_Select(&tile, twinkle_id);
+	LED_Tile_FX_Start(&tile, 100.0f);
+
+	for(uint16_t n = 0; n < 437; n++){
+		frame();
+	}
+	if(lit_channels() == 0){
+		printf("FAIL: no twinkle lit after 437 frames\n");
+		fail = 1;
+	}
+	expect_chain("twinkle");
+
+	//Posted while running, taken by the next frame
+	LED_Tile_FX_Select(&tile, sweep_id);
+	if(tile.fx.active != &LED_Tile_FX_Twinkle || tile.fx.pending != &LED_Tile_FX_Sweep){
+		printf("FAIL: the switch was not left to the next frame\n");
+		fail = 1;
+	}
+	frame();
+	if(tile.fx.active != &LED_Tile_FX_Sweep || tile.fx.pending != NULL){
+		printf("FAIL: the next frame did not switch to the sweep\n");
+		fail = 1;
+	}
+	if(((LED_Tile_Twinkle *)LED_Tile_FX_Twinkle.state)->num_active != 0){
+		printf("FAIL: twinkles left after the switch\n");
+		fail = 1;
+	}
+	expect_sweep(tile.fx.dt_us, "first sweep frame");
+	expect_chain("first sweep frame");
+
+	for(uint16_t n = 1; n < 150; n++){
+		frame();
+	}
+	expect_sweep(150 * tile.fx.dt_us, "sweep after 150 frames");
+
+	LED_Tile_FX_Stop(&tile);
+	if(lit_channels() != 0){
+		printf("FAIL: %lu channels lit after stop\n", (unsigned long)lit_channels());
+		fail = 1;
+	}
+	expect_chain("stop");
+	printf("%s: test_fx_switch\n", fail ? "FAIL" : "PASS");
+	return fail;
+}
@@ -0,0 +1,84 @@
+/*
+ * test_grad_shared_group.c
+ *
+ *  Two fades started in the same batch with the same profile share a gradation
+ *  group. The group registers are staged twice, and both stagings have to leave
+ *  the profile on the wire even when the group still holds an older profile.
+ */
+
+#include "main.h"
+#include "LED_Tile/led_tile.h"
+#include "chain_model.h"
+
+#define DEV		0
+
+LED_Tile tile;
+static Chain_Model model;
+
+static void spi_done(SPI_HandleTypeDef *h){
+	LED_Tile_SPI_Complete(&tile, h);
+}
+
+//Commit and shift everything sent since the last commit into the model
+static void commit(void){
+	LED_Tile_Commit(&tile);
+	Chain_Model_Replay(&model, hspi1.wire, hspi1.wire_len);
+	HAL_SPI_Clear_Log(&hspi1);
+}
+
+//Group of the first channel of an LED, from GRAD_GRP_SEL on the device
+static uint8_t led_group(uint8_t LED){
+	uint8_t out = 15 - TILE_LED_CH(LED, TILE_RED);
+	return (model.reg[DEV][GRAD_GRP_SEL0 + out / 4] >> ((out % 4) * 2)) & 0x03;
+}
+
+int main(void){
+	int fail = 0;
+	hal_spi_done = spi_done;
+	tile = Init_LED_Tile(2);
+	Chain_Model_Init(&model, tile.p->num_dev);
+	commit();
+
+	//Load every group of the tile with a different profile and let them all run out
+	for(uint8_t LED = 0; LED < 4; LED++){
+		LED_Tile_Begin(&tile);
+		LED_Tile_Fade_LED(&tile, DEV, LED, 0xFF, 0xFF, 0xFF, 100 * (LED + 1), 0);
+		commit();
+		hal_tick++;
+	}
+	hal_tick += 60000;
+	for(uint8_t LED = 0; LED < 4; LED++){
+		LED_Tile_Fade_Release(&tile, DEV, LED);
+	}
+	commit();
+
+	//Two same frame twinkles with one profile
+	LED_Tile_Begin(&tile);
+	LED_Tile_Fade_LED(&tile, DEV, 0, 0xFF, 0xFF, 0xFF, 700, 500);
+	LED_Tile_Fade_LED(&tile, DEV, 1, 0xFF, 0xFF, 0xFF, 700, 500);
+	commit();
+
+	uint8_t iref;
+	if(!PCA9745_Get_Shadow(tile.p, DEV, IREF15 - TILE_LED_CH(0, TILE_GREEN), &iref)){
+		iref = LED_Tile_IREF_Code(&tile, TILE_GREEN, LED_Tile_Intensity_Level(1.0f));
+	}
+	PCA9745_Grad_Profile prof = PCA9745_Grad_Make_Profile(iref, 700, 500);
+	uint8_t grp = led_group(0);
+	const uint8_t *r = &model.reg[DEV][RAMP_RATE_GRP0 + grp * (RAMP_RATE_GRP1 - RAMP_RATE_GRP0)];
+	if(led_group(1) != grp){
+		printf("FAIL: LEDs 0 and 1 are in groups %u and %u\n", grp, led_group(1));
+		fail = 1;
+	}
+	if(r[0] != prof.ramp_rate || r[1] != prof.step_time || r[2] != prof.hold || r[3] != prof.iref){
+		printf("FAIL: group %u holds %02X %02X %02X %02X, profile is %02X %02X %02X %02X\n", grp,
+				r[0], r[1], r[2], r[3], prof.ramp_rate, prof.step_time, prof.hold, prof.iref);
+		fail = 1;
+	}
+	uint32_t bad = Chain_Model_Check(&model, tile.p);
+	if(bad || model.bad_len){
+		printf("FAIL: %lu shadow registers differ from the chain, %lu short frames\n", (unsigned long)bad, (unsigned long)model.bad_len);
+		fail = 1;
+	}
+	printf("%s: test_grad_shared_group\n", fail ? "FAIL" : "PASS");
+	return fail;
+}
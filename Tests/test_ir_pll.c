@@ -0,0 +1,140 @@
+/*
+ * test_ir_pll.c
+ *
+ *  The IR strobe PLL on synthetic camera frame syncs: nominal and +-80 ppm camera
+ *  clocks with capture jitter, the 32 bit timer wrapping, a missed sync and a
+ *  glitch edge. The sync timer ISR is modelled as in LED_Tile_IR_IRQHandler, the
+ *  pulses have to lock to the requested offset from their sync.
+ */
+
+#include <math.h>
+#include "main.h"
+#include "LED_Tile/led_tile_ir.h"
+#include "LED_Tile/led_tile_rand.h"
+
+#define STEADY		40			//syncs to settle before the statistics are kept
+#define LATENCY_US	2			//sync capture to PLL update, the ISR entry
+#define MAX_ERROR	6			//pulse start - (sync + offset), us
+
+static LED_Tile_Rand rnd;
+static int fail;
+
+typedef struct {
+	const char *name;
+	double period_us;			//camera frame period
+	double ppm;					//camera clock error
+	double jitter_us;			//capture jitter, uniform +-
+	int32_t offset_us;
+	uint32_t t0;				//timer value at the first sync
+	int32_t miss_at, glitch_at;	//sync dropped, sync preceded by a glitch edge, -1 - none
+	uint32_t syncs;
+} Sync_Run;
+
+static void run(const Sync_Run *s){
+	LED_Tile_IR_PLL pll;
+	LED_Tile_IR_PLL_Reset(&pll, s->offset_us);
+	double period = s->period_us * (1 + s->ppm * 1e-6);
+	double t = s->t0;
+	uint32_t ccr = 0, pulses = 0;
+	uint8_t armed = 0;
+
+	for(uint32_t k = 0; k < s->syncs; k++){
+		double jitter = ((double)LED_Tile_Rand_Next(&rnd) / 0xFFFFFFFFUL * 2 - 1) * s->jitter_us;
+		uint32_t capture = (uint32_t)(uint64_t)floor(t + jitter);
+		t += period;
+
+		//Compare matches before this sync, each starts a pulse and the next one is aimed
+		while(armed && (int32_t)(ccr - capture) <= 0){
+			ccr = LED_Tile_IR_PLL_Fired(&pll, ccr);
+			pulses++;
+			armed = (pll.state == 2);
+		}
+		if((int32_t)k == s->miss_at){
+			continue;
+		}
+		if((int32_t)k == s->glitch_at){
+			LED_Tile_IR_PLL_Sync(&pll, capture - (uint32_t)(period / 3));
+		}
+		if(k == STEADY){
+			LED_Tile_IR_PLL_Clear_Stats(&pll);
+		}
+		if(LED_Tile_IR_PLL_Sync(&pll, capture)){
+			if(!armed){
+				pll.pulse_idx = pll.next_idx;
+			}
+			uint32_t target = LED_Tile_IR_PLL_Target(&pll);
+			uint32_t now = capture + LATENCY_US;
+			if((int32_t)(target - now) > TILE_IR_MARGIN_US && (!armed || (int32_t)(ccr - now) > TILE_IR_MARGIN_US)){
+				ccr = target;
+				armed = 1;
+			}
+		}
+	}
+
+	int32_t err_min = pll.latency_min - s->offset_us, err_max = pll.latency_max - s->offset_us;
+	double period_err = (double)pll.period / (1 << TILE_IR_Q) - period;
+	if(!pll.locked || pll.unlocks || err_min < -MAX_ERROR || err_max > MAX_ERROR){
+		printf("FAIL: %s, locked %u unlocks %lu, pulse - offset %ld..%ld us\n", s->name, pll.locked,
+				(unsigned long)pll.unlocks, (long)err_min, (long)err_max);
+		fail = 1;
+	}
+	if(period_err < -0.5 || period_err > 0.5){
+		printf("FAIL: %s, period off by %.3f us\n", s->name, period_err);
+		fail = 1;
+	}
+	if(pulses < s->syncs - STEADY){
+		printf("FAIL: %s, %lu pulses for %lu syncs\n", s->name, (unsigned long)pulses, (unsigned long)s->syncs);
+		fail = 1;
+	}
+	if(pll.missed != (s->miss_at >= STEADY) || pll.glitches != (s->glitch_at >= STEADY)){
+		printf("FAIL: %s, %lu missed and %lu glitches counted\n", s->name, (unsigned long)pll.missed, (unsigned long)pll.glitches);
+		fail = 1;
+	}
+	//The jitter is uniform, RMS jitter_us / sqrt(3), plus the 1 us capture resolution
+	uint32_t rms = LED_Tile_IR_PLL_Jitter_RMS(&pll);
+	if(rms > (uint32_t)((s->jitter_us + 1.0) * 1000) || pll.jitter_max > (uint32_t)((s->jitter_us + 1.0) * 2000)){
+		printf("FAIL: %s, jitter RMS %lu ns max %lu ns\n", s->name, (unsigned long)rms, (unsigned long)pll.jitter_max);
+		fail = 1;
+	}
+}
+
+//Without syncs the pulses freewheel for TILE_IR_MISS_MAX periods, then the PLL stops
+static void freewheel(void){
+	LED_Tile_IR_PLL pll;
+	LED_Tile_IR_PLL_Reset(&pll, 200);
+	for(uint32_t k = 0, t = 0; k < 20; k++, t += 10000){
+		LED_Tile_IR_PLL_Sync(&pll, t);
+	}
+	pll.pulse_idx = pll.next_idx;
+	uint32_t ccr = LED_Tile_IR_PLL_Target(&pll), pulses = 0;
+	while(pll.state == 2 && pulses < 100){
+		uint32_t next = LED_Tile_IR_PLL_Fired(&pll, ccr);
+		if(pll.state == 2 && next - ccr != 10000){
+			printf("FAIL: freewheel pulse %lu after %lu us\n", (unsigned long)pulses, (unsigned long)(next - ccr));
+			fail = 1;
+		}
+		ccr = next;
+		pulses++;
+	}
+	if(pulses < TILE_IR_MISS_MAX || pulses > TILE_IR_MISS_MAX + 2 || pll.state != 0){
+		printf("FAIL: freewheel stops after %lu pulses, state %u\n", (unsigned long)pulses, pll.state);
+		fail = 1;
+	}
+}
+
+int main(void){
+	static const Sync_Run runs[] = {
+		{"30 fps", 33333.333, 0, 0, 500, 1000, -1, -1, 300},
+		{"30 fps +80 ppm", 33333.333, 80, 2.0, 500, 1000, -1, -1, 300},
+		{"30 fps -80 ppm ahead", 33333.333, -80, 2.0, -2000, 1000, -1, -1, 300},
+		{"60 fps timer wrap", 16666.667, 30, 1.0, 100, 0xFFFF0000UL, 150, 200, 600},
+		{"120 fps ahead", 8333.333, 0, 3.0, -300, 5, 100, -1, 600},
+	};
+	LED_Tile_Rand_Seed(&rnd, 25, 0);
+	for(uint32_t i = 0; i < sizeof(runs) / sizeof(runs[0]); i++){
+		run(&runs[i]);
+	}
+	freewheel();
+	printf("%s: test_ir_pll\n", fail ? "FAIL" : "PASS");
+	return fail;
+}
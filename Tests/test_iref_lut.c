@@ -0,0 +1,58 @@
+/*
+ * test_iref_lut.c
+ *
+ *  The IREF lookup tables stand in for the Newton-Raphson solver. Over the whole
+ *  range from 0 to MAX_INTESITY every colour's table code has to be within one
+ *  IREF code of the solver's code, saturated at 0xFF like the table.
+ */
+
+#include "main.h"
+#include "LED_Tile/led_tile.h"
+
+#define SWEEP		20000		//intensity steps over 0 - MAX_INTESITY
+#define MAX_ERROR	1			//IREF codes
+
+LED_Tile tile;
+
+static const float coef[TILE_NUM_COLORS][2] = {
+	[TILE_RED] = {R_A, R_B},
+	[TILE_GREEN] = {G_A, G_B},
+	[TILE_BLUE] = {B_A, B_B},
+	[TILE_IR] = {IR_A, IR_B},
+};
+
+int main(void){
+	int fail = 0;
+	tile = Init_LED_Tile(1);
+
+	for(uint8_t color = 0; color < TILE_NUM_COLORS; color++){
+		uint8_t worst = 0;
+		float worst_at = 0.0f;
+		for(uint32_t i = 0; i <= SWEEP; i++){
+			float intensity = MAX_INTESITY * i / SWEEP;
+			float exact = 4 * tile.p->r_ext * Get_Intensity(intensity, coef[color][0], coef[color][1]) / 900;
+			uint8_t expected = (exact > 255.0f) ? 255 : (exact < 0.0f) ? 0 : (uint8_t)exact;
+			uint8_t code = LED_Tile_IREF_Code(&tile, color, LED_Tile_Intensity_Level(intensity));
+			uint8_t error = (code > expected) ? code - expected : expected - code;
+			if(error > worst){
+				worst = error;
+				worst_at = intensity;
+			}
+		}
+		if(worst > MAX_ERROR){
+			printf("FAIL: colour %u is %u IREF codes off the solver at intensity %.4f\n", color, worst, worst_at);
+			fail = 1;
+		}
+	}
+
+	//The on-target benchmark reports the same bound for red
+	uint32_t solver_cycles, lut_cycles;
+	uint8_t max_error;
+	LED_Tile_Benchmark_IREF(&tile, &solver_cycles, &lut_cycles, &max_error);
+	if(max_error > MAX_ERROR){
+		printf("FAIL: LED_Tile_Benchmark_IREF reports an error of %u codes\n", max_error);
+		fail = 1;
+	}
+	printf("%s: test_iref_lut\n", fail ? "FAIL" : "PASS");
+	return fail;
+}
@@ -0,0 +1,151 @@
+/*
+ * test_map_wall.c
+ *
+ *  A 3-tile wall with tiles at 0, 90 and 180 degrees maps every pixel to the
+ *  expected framebuffer channels, overlapping tiles are rejected, and
+ *  LED_Tile_Set_LED_Intensity writes only the IREF registers of the LED asked for.
+ */
+
+#include "main.h"
+#include "LED_Tile/led_tile.h"
+#include "LED_Tile/led_tile_map.h"
+#include "chain_model.h"
+
+#define TILES	3
+#define W		6
+#define H		5
+
+LED_Tile tile;
+static Chain_Model model;
+static int fail;
+
+static void spi_done(SPI_HandleTypeDef *h){
+	LED_Tile_SPI_Complete(&tile, h);
+}
+
+static void replay(void){
+	Chain_Model_Replay(&model, hspi1.wire, hspi1.wire_len);
+	HAL_SPI_Clear_Log(&hspi1);
+}
+
+//Tile 0 along the top row, tile 1 turned down the right edge, tile 2 reversed along row 1
+static const LED_Tile_Placement wall[TILES] = {
+	{0, 0, TILE_ROT_0},
+	{5, 0, TILE_ROT_90},
+	{0, 1, TILE_ROT_180},
+};
+
+//Expected tile and LED at each pixel, -1 for no LED
+static const int8_t at[H][W][2] = {
+	{{0, 0}, {0, 1}, {0, 2}, {0, 3}, {0, 4}, {1, 0}},
+	{{2, 4}, {2, 3}, {2, 2}, {2, 1}, {2, 0}, {1, 1}},
+	{{-1, 0}, {-1, 0}, {-1, 0}, {-1, 0}, {-1, 0}, {1, 2}},
+	{{-1, 0}, {-1, 0}, {-1, 0}, {-1, 0}, {-1, 0}, {1, 3}},
+	{{-1, 0}, {-1, 0}, {-1, 0}, {-1, 0}, {-1, 0}, {1, 4}},
+};
+
+static void check_map(void){
+	for(uint16_t y = 0; y < H; y++){
+		for(uint16_t x = 0; x < W; x++){
+			uint16_t off = tile.map->off[LED_Tile_Map_Index(&tile, x, y)];
+			uint16_t expected = (at[y][x][0] < 0) ? TILE_MAP_NONE :
+					at[y][x][0] * sizeof(LED_Tile_Pixels) + TILE_LED_CH(at[y][x][1], TILE_RED);
+			if(off != expected){
+				printf("FAIL: pixel %u,%u maps to %u, expected %u\n", x, y, off, expected);
+				fail = 1;
+			}
+		}
+	}
+	if(tile.map->num_pixels != TILES * TILE_NUM_LEDS){
+		printf("FAIL: %u pixels placed\n", tile.map->num_pixels);
+		fail = 1;
+	}
+
+	//Drawing goes to the channels of that LED and nowhere else
+	memset(tile.fb, 0, TILES * sizeof(LED_Tile_Pixels));
+	LED_Tile_Draw_XY(&tile, 5, 4, 1, 2, 3);
+	LED_Tile_Draw_XY(&tile, 0, 4, 9, 9, 9);
+	for(uint16_t dev = 0; dev < TILES; dev++){
+		for(uint8_t ch = 0; ch < 16; ch++){
+			uint8_t expected = 0;
+			if(dev == 1 && ch >= TILE_LED_CH(4, TILE_RED) && ch <= TILE_LED_CH(4, TILE_BLUE)){
+				expected = ch - TILE_LED_CH(4, TILE_RED) + 1;
+			}
+			if(tile.fb[dev].ch[ch] != expected){
+				printf("FAIL: drawing 5,4 sets tile %u channel %u to %u\n", dev, ch, tile.fb[dev].ch[ch]);
+				fail = 1;
+			}
+		}
+	}
+}
+
+//Only the three IREF registers of LED led on device dev may change
+static void check_intensity(uint16_t dev, uint8_t led){
+	uint8_t before[TILES][PCA9745_SHADOW_SIZE];
+	memcpy(before, model.reg, sizeof(before));
+	uint8_t code[3];
+	uint16_t level = LED_Tile_Intensity_Level(1.0f);
+	code[TILE_RED] = LED_Tile_IREF_Code(&tile, TILE_RED, level);
+	code[TILE_GREEN] = LED_Tile_IREF_Code(&tile, TILE_GREEN, level);
+	code[TILE_BLUE] = LED_Tile_IREF_Code(&tile, TILE_BLUE, level);
+
+	LED_Tile_Set_LED_Intensity(&tile, dev, led, 1.0f);
+	replay();
+	for(uint16_t d = 0; d < TILES; d++){
+		for(uint8_t reg = 0; reg < PCA9745_SHADOW_SIZE; reg++){
+			uint8_t expected = before[d][reg];
+			for(uint8_t color = TILE_RED; color <= TILE_BLUE; color++){
+				if(d == dev && reg == IREF15 - TILE_LED_CH(led, color)){
+					expected = code[color];
+				}
+			}
+			if(model.reg[d][reg] != expected){
+				printf("FAIL: intensity of LED %u on tile %u sets register %02X of tile %u to %02X, expected %02X\n",
+						led, dev, reg, d, model.reg[d][reg], expected);
+				fail = 1;
+			}
+		}
+	}
+}
+
+int main(void){
+	hal_spi_done = spi_done;
+	tile = Init_LED_Tile(TILES);
+	Chain_Model_Init(&model, tile.p->num_dev);
+	LED_Tile_Clear_All(&tile);
+	replay();
+
+	if(!LED_Tile_Map_Build(&tile, wall, W, H)){
+		printf("FAIL: wall rejected\n");
+		fail = 1;
+	}
+	else{
+		check_map();
+	}
+
+	//Tile 1 overlaps the last LED of tile 0
+	static const LED_Tile_Placement overlap[TILES] = {{0, 0, TILE_ROT_0}, {4, 0, TILE_ROT_0}, {0, 1, TILE_ROT_0}};
+	if(LED_Tile_Map_Build(&tile, overlap, 10, 2) || tile.map != NULL){
+		printf("FAIL: overlapping tiles accepted\n");
+		fail = 1;
+	}
+	//Tile 1 turned past the bottom edge
+	static const LED_Tile_Placement outside[TILES] = {{0, 0, TILE_ROT_0}, {5, 0, TILE_ROT_270}, {0, 1, TILE_ROT_0}};
+	if(LED_Tile_Map_Build(&tile, outside, W, 2)){
+		printf("FAIL: tile outside the wall accepted\n");
+		fail = 1;
+	}
+
+	//LED 0 is IREF15..13, the old LED * 3 - k reached past IREF15
+	check_intensity(0, 0);
+	check_intensity(1, 2);
+	check_intensity(2, TILE_NUM_LEDS - 1);
+
+	uint32_t bad = Chain_Model_Check(&model, tile.p);
+	if(bad || model.bad_len){
+		printf("FAIL: %lu shadow registers differ from the chain, %lu short frames\n", (unsigned long)bad, (unsigned long)model.bad_len);
+		fail = 1;
+	}
+	printf("%s: test_map_wall\n", fail ? "FAIL" : "PASS");
+	return fail;
+}
@@ -0,0 +1,88 @@
+/*
+ * test_master.c
+ *
+ *  LED_Tile_Set_Master puts every channel in LEDOUT state 11 once, then a new
+ *  level is a single GRPPWM frame for the whole chain and a repeated level sends
+ *  nothing. LED_Tile_Set_Blink switches MODE2 to blinking and back.
+ */
+
+#include "main.h"
+#include "LED_Tile/led_tile.h"
+#include "chain_model.h"
+
+#define TILES	10
+
+LED_Tile tile;
+static Chain_Model model;
+static int fail;
+
+static void spi_done(SPI_HandleTypeDef *h){
+	LED_Tile_SPI_Complete(&tile, h);
+}
+
+static void replay(void){
+	Chain_Model_Replay(&model, hspi1.wire, hspi1.wire_len);
+	HAL_SPI_Clear_Log(&hspi1);
+}
+
+static void expect_frames(uint32_t frames, const char *what){
+	if(hspi1.frames != frames){
+		printf("FAIL: %s sends %lu frames, expected %lu\n", what, (unsigned long)hspi1.frames, (unsigned long)frames);
+		fail = 1;
+	}
+	replay();
+}
+
+static void expect_reg(uint8_t reg, uint8_t value, const char *what){
+	for(uint16_t dev = 0; dev < model.num_dev; dev++){
+		if(model.reg[dev][reg] != value){
+			printf("FAIL: %s, register %02X of device %u is %02X, expected %02X\n", what, reg, dev, model.reg[dev][reg], value);
+			fail = 1;
+		}
+	}
+}
+
+int main(void){
+	hal_spi_done = spi_done;
+	tile = Init_LED_Tile(TILES);
+	Chain_Model_Init(&model, tile.p->num_dev);
+	LED_Tile_Clear_All(&tile);
+	replay();
+
+	//LEDOUT0 - LEDOUT3, MODE2 and GRPPWM
+	LED_Tile_Set_Master(&tile, 255);
+	expect_frames(6, "first master level");
+	for(uint8_t reg = LEDOUT0; reg <= LEDOUT3; reg++){
+		expect_reg(reg, 0xFF, "first master level");
+	}
+	expect_reg(MODE2, PCA9745_MODE2_DEFAULT, "first master level");
+	expect_reg(GRPPWM, 255, "first master level");
+
+	LED_Tile_Set_Master(&tile, 128);
+	expect_frames(1, "new master level");
+	expect_reg(GRPPWM, 128, "new master level");
+
+	LED_Tile_Set_Master(&tile, 128);
+	expect_frames(0, "same master level");
+
+	//GRPFREQ, GRPPWM and MODE2, a 1 s period is 15 periods of the group oscillator
+	LED_Tile_Set_Blink(&tile, 1000, 64);
+	expect_frames(3, "blink");
+	expect_reg(GRPFREQ, 14, "blink");
+	expect_reg(GRPPWM, 64, "blink");
+	expect_reg(MODE2, PCA9745_MODE2_DEFAULT | PCA9745_MODE2_DMBLNK, "blink");
+
+	//Back to dimming at the master level
+	LED_Tile_Set_Blink(&tile, 0, 0);
+	expect_frames(2, "stop blinking");
+	expect_reg(MODE2, PCA9745_MODE2_DEFAULT, "stop blinking");
+	expect_reg(GRPPWM, 128, "stop blinking");
+
+	uint32_t bad = Chain_Model_Check(&model, tile.p);
+	if(bad || model.bad_len){
+		printf("FAIL: %lu shadow registers differ from the chain, %lu short frames\n", (unsigned long)bad, (unsigned long)model.bad_len);
+		fail = 1;
+	}
+	printf("%s: test_master\n", fail ? "FAIL" : "PASS");
+	return fail;
+}
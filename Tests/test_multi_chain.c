@@ -0,0 +1,95 @@
+/*
+ * test_multi_chain.c
+ *
+ *  Three chains on SPI1/SPI2/SPI3 with DMA. A commit steps the chains in turn, so
+ *  every bus is shifting a frame at the same time, and each tile's channels have to
+ *  land on the device its global index maps to.
+ */
+
+#include "main.h"
+#include "LED_Tile/led_tile.h"
+#include "chain_model.h"
+
+#define TILES	8		//3 + 3 + 2
+
+extern SPI_HandleTypeDef hspi1, hspi2, hspi3;
+static SPI_HandleTypeDef *const bus[TILE_NUM_CHAINS] = {&hspi1, &hspi2, &hspi3};
+
+LED_Tile tile;
+static Chain_Model model[TILE_NUM_CHAINS];
+static uint8_t overlap;			//most other buses in flight when a transfer finished
+static int fail;
+
+static void spi_done(SPI_HandleTypeDef *h){
+	uint8_t n = 0;
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		n += (bus[c] != h && bus[c]->dma_pending);
+	}
+	if(n > overlap){
+		overlap = n;
+	}
+	LED_Tile_SPI_Complete(&tile, h);
+}
+
+//Let every bus drain and shift its log into the chain's model
+static void drain(void){
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		PCA9745_Flush(tile.chain[c]);
+		Chain_Model_Replay(&model[c], bus[c]->wire, bus[c]->wire_len);
+		if(bus[c]->cs_errors || bus[c]->dma_corrupt || bus[c]->dma_busy){
+			printf("FAIL: bus %u, %lu transfers with nCS high, %lu corrupt, %lu refused\n", c,
+					(unsigned long)bus[c]->cs_errors, (unsigned long)bus[c]->dma_corrupt, (unsigned long)bus[c]->dma_busy);
+			fail = 1;
+		}
+		HAL_SPI_Clear_Log(bus[c]);
+	}
+}
+
+int main(void){
+	hal_spi_done = spi_done;
+	tile = Init_LED_Tile(TILES);
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		Chain_Model_Init(&model[c], tile.chain[c]->num_dev);
+	}
+	LED_Tile_Clear_All(&tile);
+	drain();
+
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		bus[c]->async = 1;
+	}
+	overlap = 0;
+	for(uint16_t t = 0; t < TILES; t++){
+		for(uint8_t led = 0; led < TILE_NUM_LEDS; led++){
+			LED_Tile_Draw_LED(&tile, t, led, t + 1, 0x10 * led, 0x80 + t);
+		}
+	}
+	LED_Tile_Commit(&tile);
+	drain();
+
+	if(overlap != TILE_NUM_CHAINS - 1){
+		printf("FAIL: %u other buses in flight at most, expected %u\n", overlap, TILE_NUM_CHAINS - 1);
+		fail = 1;
+	}
+	for(uint16_t t = 0; t < TILES; t++){
+		uint16_t dev;
+		uint8_t c = LED_Tile_Get_Chain_Index(&tile, t, &dev);
+		for(uint8_t led = 0; led < TILE_NUM_LEDS; led++){
+			const uint8_t *reg = model[c].reg[dev];
+			if(reg[PWM15 - TILE_LED_CH(led, TILE_RED)] != t + 1 ||
+					reg[PWM15 - TILE_LED_CH(led, TILE_GREEN)] != 0x10 * led ||
+					reg[PWM15 - TILE_LED_CH(led, TILE_BLUE)] != 0x80 + t){
+				printf("FAIL: tile %u LED %u on chain %u device %u is wrong\n", t, led, c, dev);
+				fail = 1;
+			}
+		}
+	}
+	for(uint8_t c = 0; c < TILE_NUM_CHAINS; c++){
+		uint32_t bad = Chain_Model_Check(&model[c], tile.chain[c]);
+		if(bad || model[c].bad_len){
+			printf("FAIL: chain %u, %lu shadow registers differ, %lu short frames\n", c, (unsigned long)bad, (unsigned long)model[c].bad_len);
+			fail = 1;
+		}
+	}
+	printf("%s: test_multi_chain\n", fail ? "FAIL" : "PASS");
+	return fail;
+}
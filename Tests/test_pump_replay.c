@@ -0,0 +1,120 @@
+/*
+ * test_pump_replay.c
+ *
+ *  LED_Tile_Commit through the frame pump. Each captured list is replayed one
+ *  byte per slot timer update against the nCS timer's compare level, the way
+ *  the DMA and the two timers would send it, into a model of the chain. Every
+ *  latch must see a whole frame, pad slots must carry only the pad byte and the
+ *  chain must end up holding what the shadow says it holds.
+ */
+
+#include "main.h"
+#include "LED_Tile/led_tile.h"
+#include "chain_model.h"
+
+#define NUM_TILES_TEST	10
+#define ROUNDS			8
+
+LED_Tile tile;
+static Chain_Model model;
+static PCA9745_Pump pump;
+static uint8_t list[17 * PCA9745_PUMP_STRIDE(NUM_TILES_TEST)];
+static TIM_TypeDef slot_tim, cs_tim;
+static TIM_HandleTypeDef htim_slot = {.Instance = &slot_tim};
+static TIM_HandleTypeDef htim_cs = {.Instance = &cs_tim};
+static DMA_Stream_TypeDef stream;
+static GPIO_TypeDef cs_port;
+
+static uint8_t cs_low;
+static uint32_t pad_bad;
+
+static void cs_level(uint8_t level){
+	if(!cs_low && level == 0){
+		model.bytes = 0;
+	}
+	if(cs_low && level == 1){
+		Chain_Model_Latch(&model);
+	}
+	cs_low = (level == 0);
+}
+
+//One list, one byte per slot. The nCS timer counts a slot lead ticks before its byte.
+static void replay(void){
+	uint32_t cnt = cs_tim.CNT;
+	if(hal_dma_src != (uint32_t)(uintptr_t)pump.list){
+		printf("FAIL: DMA does not start at the list\n");
+		pad_bad++;
+	}
+	for(uint32_t k = 0; k < hal_dma_len; k++){
+		cnt = (cnt + 1) % (cs_tim.ARR + 1);
+		cs_level(cnt < cs_tim.CCR1 ? 0 : 1);
+		if(cs_low){
+			Chain_Model_Shift(&model, pump.list[k]);
+		}
+		else if(pump.list[k] != PCA9745_PUMP_PAD_BYTE){
+			pad_bad++;
+		}
+	}
+	cs_tim.CNT = cnt;
+	stream.NDTR = 0;
+	tile.p->hspi->Instance->SR = SPI_FLAG_TXE;
+	PCA9745_Pump_IRQHandler(&pump);
+	cs_level(cs_tim.CNT < cs_tim.CCR1 ? 0 : 1);
+}
+
+int main(void){
+	int fail = 0;
+	tile = Init_LED_Tile(NUM_TILES_TEST);
+	tile.p->gpio_port_nCS = &cs_port;
+	PCA9745_Pump_Init(&pump, tile.p, list, sizeof(list), &htim_slot, 104, 8, &htim_cs, TIM_TS_ITR1, TIM_CHANNEL_1, 1, &stream, 7);
+	tile.pump = &pump;
+	Chain_Model_Init(&model, tile.p->num_dev);
+	Chain_Model_Replay(&model, hspi1.wire, hspi1.wire_len);
+
+	if(slot_tim.CCR1 != slot_tim.ARR + 1 - 8){
+		printf("FAIL: slot timer OC1REF is not lead ticks before the update\n");
+		fail = 1;
+	}
+
+	srand(1);
+	for(uint8_t round = 0; round < ROUNDS; round++){
+		for(uint16_t dev = 0; dev < NUM_TILES_TEST; dev++){
+			for(uint8_t ch = 0; ch < 16; ch++){
+				if(round == 0 || rand() % 4 == 0){
+					tile.fb[dev].ch[ch] = rand();
+				}
+			}
+		}
+		if(round == 2){
+			memset(tile.fb[3].ch, 77, 16);		//PWMALL
+		}
+
+		HAL_SPI_Clear_Log(&hspi1);
+		hal_dma_len = 0;
+		LED_Tile_Commit(&tile);
+		if(hspi1.wire_len != 0){
+			printf("FAIL: round %u sent %lu bytes by CPU SPI\n", round, (unsigned long)hspi1.wire_len);
+			fail = 1;
+		}
+		if(hal_dma_len != 0){
+			if(hal_dma_len != pump.frames * PCA9745_PUMP_STRIDE(tile.p->num_dev) - PCA9745_PUMP_PAD){
+				printf("FAIL: round %u list of %lu bytes for %u frames\n", round, (unsigned long)hal_dma_len, pump.frames);
+				fail = 1;
+			}
+			replay();
+		}
+		if(tile.p->busy || cs_low){
+			printf("FAIL: round %u left the chain busy or nCS low\n", round);
+			fail = 1;
+		}
+	}
+
+	uint32_t bad = Chain_Model_Check(&model, tile.p);
+	if(model.bad_len || pad_bad || pump.late || bad){
+		printf("FAIL: %lu short latches, %lu pad slot errors, %lu late stops, %lu shadow registers differ from the chain\n",
+				(unsigned long)model.bad_len, (unsigned long)pad_bad, (unsigned long)pump.late, (unsigned long)bad);
+		fail = 1;
+	}
+	printf("%s: test_pump_replay (%lu latches)\n", fail ? "FAIL" : "PASS", (unsigned long)model.latches);
+	return fail;
+}
@@ -0,0 +1,52 @@
+/*
+ * test_rand_pcg32.c
+ *
+ *  LED_Tile_Rand is PCG32 (XSH RR). Seeded like the reference pcg32-demo, seed 42
+ *  and stream 54, it has to give the reference output, and LED_Tile_Rand_Range has
+ *  to be uniform.
+ */
+
+#include "main.h"
+#include "LED_Tile/led_tile_rand.h"
+
+#define DRAWS	1000000
+
+//First outputs of the reference pcg32_srandom_r(&rng, 42u, 54u)
+static const uint32_t reference[] = {0xa15c02b7, 0x7b47f409, 0xba1d3330, 0x83d2f293, 0xbfa4784b, 0xcbed606e};
+
+int main(void){
+	int fail = 0;
+	LED_Tile_Rand r;
+	LED_Tile_Rand_Seed(&r, 42, 54);
+	for(uint8_t i = 0; i < sizeof(reference) / sizeof(reference[0]); i++){
+		uint32_t v = LED_Tile_Rand_Next(&r);
+		if(v != reference[i]){
+			printf("FAIL: output %u is %08lx, reference %08lx\n", i, (unsigned long)v, (unsigned long)reference[i]);
+			fail = 1;
+		}
+	}
+
+	//Every bucket within 1 % of DRAWS / 5
+	uint32_t hist[5] = {0};
+	for(uint32_t i = 0; i < DRAWS; i++){
+		uint32_t v = LED_Tile_Rand_Range(&r, 5);
+		if(v >= 5){
+			printf("FAIL: LED_Tile_Rand_Range(5) returned %lu\n", (unsigned long)v);
+			fail = 1;
+			break;
+		}
+		hist[v]++;
+	}
+	for(uint8_t i = 0; i < 5; i++){
+		if(hist[i] < DRAWS / 5 * 99 / 100 || hist[i] > DRAWS / 5 * 101 / 100){
+			printf("FAIL: value %u drawn %lu times of %u\n", i, (unsigned long)hist[i], DRAWS);
+			fail = 1;
+		}
+	}
+	if(LED_Tile_Rand_Range(&r, 0) != 0){
+		printf("FAIL: LED_Tile_Rand_Range(0) is not 0\n");
+		fail = 1;
+	}
+	printf("%s: test_rand_pcg32\n", fail ? "FAIL" : "PASS");
+	return fail;
+}
@@ -0,0 +1,91 @@
+/*
+ * test_shadow_broadcast.c
+ *
+ *  PWMALL/IREFALL sent through PCA9745_Stage or PCA9745_Write_Multi set all sixteen
+ *  PWMx/IREFx registers of the device. The shadow has to follow, or a later write of the value a
+ *  register held before the broadcast is skipped as unchanged.
+ */
+
+#include "main.h"
+#include "PCA9745/pca9745.h"
+#include "chain_model.h"
+
+#define NUM_DEV		3
+
+extern SPI_HandleTypeDef hspi1;
+static PCA9745_Arena arena;
+static PCA9745 p;
+static Chain_Model model;
+static int fail;
+
+static void sync_check(const char *what){
+	Chain_Model_Replay(&model, hspi1.wire, hspi1.wire_len);
+	HAL_SPI_Clear_Log(&hspi1);
+	uint32_t bad = Chain_Model_Check(&model, &p);
+	if(bad){
+		printf("FAIL: %s, %lu shadow registers differ from the chain\n", what, (unsigned long)bad);
+		fail = 1;
+	}
+}
+
+static void expect_reg(uint16_t dev, uint8_t reg, uint8_t data, const char *what){
+	if(model.reg[dev][reg] != data){
+		printf("FAIL: %s, device %u register %02X is %02X, expected %02X\n", what, dev, reg, model.reg[dev][reg], data);
+		fail = 1;
+	}
+}
+
+int main(void){
+	p = Init_PCA9745(&hspi1, nCS_GPIO_Port, nCS_Pin, nOE_GPIO_Port, nOE_Pin);
+	_PCA9745_Configure(&p, 1000, NUM_DEV, &arena);
+	Chain_Model_Init(&model, NUM_DEV);
+
+	//Write through: PWM3, PWMALL, then PWM3 back to its old value
+	PCA9745_Stage(&p, 1, PWM0 + 3, 0x40);
+	PCA9745_Stage(&p, 1, PWMALL, 0x10);
+	PCA9745_Stage(&p, 1, PWM0 + 3, 0x40);
+	sync_check("PWM3 after PWMALL");
+	expect_reg(1, PWM0 + 3, 0x40, "PWM3 after PWMALL");
+	expect_reg(1, PWM0 + 4, 0x10, "PWM4 after PWMALL");
+
+	PCA9745_Stage(&p, 2, IREF0 + 15, 0x80);
+	PCA9745_Stage(&p, 2, IREFALL, 0x20);
+	PCA9745_Stage(&p, 2, IREF0 + 15, 0x80);
+	sync_check("IREF15 after IREFALL");
+	expect_reg(2, IREF0 + 15, 0x80, "IREF15 after IREFALL");
+
+	//Deferred: the broadcast goes out at once and replaces what was staged before it
+	PCA9745_Set_Deferred(&p, 1);
+	PCA9745_Stage(&p, 0, PWM0 + 5, 0x22);
+	PCA9745_Stage(&p, 0, PWMALL, 0x33);
+	PCA9745_Stage(&p, 0, PWM0 + 6, 0x44);
+	PCA9745_Set_Deferred(&p, 0);
+	sync_check("staged PWM around PWMALL");
+	expect_reg(0, PWM0 + 5, 0x33, "PWM5 staged before PWMALL");
+	expect_reg(0, PWM0 + 6, 0x44, "PWM6 staged after PWMALL");
+
+	//Write_Multi: broadcasts of two devices share one frame, the third device's two writes
+	//take a frame each
+	PCA9745_Stage(&p, 0, PWM0 + 3, 0x40);
+	PCA9745_Stage(&p, 1, IREF0 + 2, 0x80);
+	const PCA9745_Reg_Write writes[] = {
+		{0, PWMALL, 0x11},
+		{1, IREFALL, 0x21},
+		{2, PWM0 + 1, 0x7F},
+		{2, PWMALL, 0xFF},
+	};
+	uint16_t frames = PCA9745_Write_Multi(&p, writes, 4);
+	PCA9745_Stage(&p, 0, PWM0 + 3, 0x40);
+	PCA9745_Stage(&p, 1, IREF0 + 2, 0x80);
+	sync_check("Write_Multi broadcasts");
+	if(frames != 2){
+		printf("FAIL: Write_Multi took %u frames, expected 2\n", frames);
+		fail = 1;
+	}
+	expect_reg(0, PWM0 + 3, 0x40, "PWM3 after Write_Multi PWMALL");
+	expect_reg(1, IREF0 + 2, 0x80, "IREF2 after Write_Multi IREFALL");
+	expect_reg(2, PWM0 + 1, 0xFF, "PWM1 after Write_Multi PWMALL");
+
+	printf("%s: test_shadow_broadcast\n", fail ? "FAIL" : "PASS");
+	return fail;
+}
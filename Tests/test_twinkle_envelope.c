@@ -0,0 +1,76 @@
+/*
+ * test_twinkle_envelope.c
+ *
+ *  The twinkle envelope is advanced in Q30 fixed point. Rendered one at a time at
+ *  100 Hz, every twinkle has to stay within one PWM code of the float envelope
+ *  scale * (exp(-a_0 * t) - exp(-a_1 * t)) it replaces, from spawn until it ends.
+ */
+
+#include "main.h"
+#include "LED_Tile/led_tile.h"
+#include "LED_Tile/led_tile_twinkle.h"
+#include <math.h>
+
+#define TILES		4
+#define DT_US		10000		//100 Hz
+#define TRIALS		3000
+#define MAX_ERROR	1			//PWM codes
+
+LED_Tile tile;
+
+int main(void){
+	int fail = 0;
+	const LED_Tile_Effect *fx = &LED_Tile_FX_Twinkle;
+	LED_Tile_Twinkle *s = fx->state;
+	tile = Init_LED_Tile(TILES);
+
+	LED_Tile_Twinkle_Seed(42);
+	LED_Tile_Twinkle_Config(0, 1);
+	fx->init(&tile, s, DT_US);
+
+	int worst = 0;
+	uint32_t updates = 0;
+	for(uint16_t trial = 0; trial < TRIALS; trial++){
+		//Spawn one twinkle and follow it alone, replaying the spawn's draws for its colour
+		LED_Tile_Rand rand = s->rand;
+		LED_Tile_Twinkle_Config(TWINKLE_CHANCE, 1);
+		fx->render(&tile, s, DT_US);
+		LED_Tile_Twinkle_Config(0, 1);
+		if(s->num_active != 1){
+			printf("FAIL: trial %u did not spawn a twinkle\n", trial);
+			fail = 1;
+			break;
+		}
+		RGB_LED *tw = &s->slot[s->active[0]];
+		LED_Tile_Rand_Range(&rand, TILES);
+		LED_Tile_Rand_Range(&rand, TILE_NUM_LEDS);
+		LED_Tile_Rand_Range(&rand, TWINKLE_K0_NUM);
+		LED_Tile_Rand_Range(&rand, TWINKLE_DK_NUM);
+		float red = LED_Tile_Rand_Range(&rand, 255);
+
+		float a_0 = (float)tw->k_0 / TWINKLE_A_DIV, a_1 = (float)tw->k_1 / TWINKLE_A_DIV;
+		float t_max = logf(a_1 / a_0) / (a_1 - a_0);
+		float scale = red / (expf(-a_0 * t_max) - expf(-a_1 * t_max));
+		uint8_t *ch = &tile.fb[tw->dev].ch[TILE_LED_CH(tw->led, TILE_RED)];
+		for(uint32_t n = 1; s->num_active > 0; n++){
+			fx->render(&tile, s, DT_US);
+			updates++;
+			if(s->num_active == 0){
+				break;
+			}
+			float t = n * (DT_US / 1000000.0f);
+			int ref = (int)(scale * (expf(-a_0 * t) - expf(-a_1 * t)));
+			int error = abs(ref - *ch);
+			if(error > worst){
+				worst = error;
+			}
+			if(error > MAX_ERROR && !fail){
+				printf("FAIL: k %u/%u red %.0f at update %lu is %u, float envelope %d\n",
+						tw->k_0, tw->k_1, red, (unsigned long)n, *ch, ref);
+			}
+			fail |= (error > MAX_ERROR);
+		}
+	}
+	printf("%s: test_twinkle_envelope (%lu updates, max error %d)\n", fail ? "FAIL" : "PASS", (unsigned long)updates, worst);
+	return fail;
+}
@@ -0,0 +1,81 @@
+/*
+ * test_twinkle_pool.c
+ *
+ *  The twinkle pool keeps a packed active list, a free slot bitmap and an LED
+ *  occupancy bitmap. After every update the three have to agree, a dense field
+ *  has to fill all TWINKLE_NUM_MAX slots, and stopping must leave no LED lit.
+ */
+
+#include "main.h"
+#include "LED_Tile/led_tile.h"
+#include "LED_Tile/led_tile_twinkle.h"
+
+#define TILES		64
+#define DT_US		10000
+#define UPDATES		20000
+
+LED_Tile tile;
+
+//Active list, free and occupancy bitmaps describe the same set of twinkles
+static int pool_consistent(const LED_Tile_Twinkle *s){
+	uint16_t free = 0, occupied = 0;
+	for(uint16_t w = 0; w < TWINKLE_NUM_MAX / 32; w++){
+		free += __builtin_popcount(s->free[w]);
+	}
+	for(uint16_t w = 0; w < (TWINKLE_NUM_LEDS + 31) / 32; w++){
+		occupied += __builtin_popcount(s->occupied[w]);
+	}
+	if(free != TWINKLE_NUM_MAX - s->num_active || occupied != s->num_active){
+		return 0;
+	}
+	for(uint16_t i = 0; i < s->num_active; i++){
+		uint16_t slot = s->active[i];
+		const RGB_LED *tw = &s->slot[slot];
+		uint32_t pos = tw->dev * TILE_NUM_LEDS + tw->led;
+		if(!tw->active || (s->free[slot >> 5] & (0x01UL << (slot & 0x1F))) ||
+				!(s->occupied[pos >> 5] & (0x01UL << (pos & 0x1F)))){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int main(void){
+	int fail = 0;
+	const LED_Tile_Effect *fx = &LED_Tile_FX_Twinkle;
+	LED_Tile_Twinkle *s = fx->state;
+	tile = Init_LED_Tile(TILES);
+	LED_Tile_Twinkle_Config(6 * TWINKLE_CHANCE, TWINKLE_NUM_MAX);
+	fx->init(&tile, s, DT_US);
+
+	uint16_t most = 0;
+	for(uint32_t n = 0; n < UPDATES; n++){
+		fx->render(&tile, s, DT_US);
+		if(s->num_active > most){
+			most = s->num_active;
+		}
+		if(!pool_consistent(s)){
+			printf("FAIL: pool bitmaps disagree with %u active twinkles at update %lu\n", s->num_active, (unsigned long)n);
+			fail = 1;
+			break;
+		}
+	}
+	if(most != TWINKLE_NUM_MAX){
+		printf("FAIL: at most %u twinkles, the pool holds %u\n", most, TWINKLE_NUM_MAX);
+		fail = 1;
+	}
+
+	fx->teardown(&tile, s);
+	uint32_t lit = 0;
+	for(uint16_t dev = 0; dev < TILES; dev++){
+		for(uint8_t ch = 0; ch < 15; ch++){
+			lit += (tile.fb[dev].ch[ch] != 0);
+		}
+	}
+	if(s->num_active != 0 || lit != 0 || !pool_consistent(s)){
+		printf("FAIL: after stop %u twinkles active, %lu channels lit\n", s->num_active, (unsigned long)lit);
+		fail = 1;
+	}
+	printf("%s: test_twinkle_pool\n", fail ? "FAIL" : "PASS");
+	return fail;
+}